@@ -0,0 +1,21 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef AOT_H
+#define AOT_H
+
+// Built in with -DCVM8_AOT_SOURCE=my_rom_aot.c, see tools/cvm8_aot.c.
+#ifdef CVM8_AOT
+
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+#include "render_engine.h"
+
+// Same contract as a CpuCoreFn, implemented by the generated file.
+// Anything not statically discovered falls back to the interpreter.
+void aot_run_cycles(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles);
+
+#endif
+
+#endif
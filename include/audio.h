@@ -4,14 +4,31 @@
 #ifndef AUDIO_H
 #define AUDIO_H
 
-#include <SDL2/SDL_mixer.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "sound.h"
 
+#define AUDIO_SAMPLE_RATE 48000
+// Samples per callback, 256 at 48 kHz is about 5 ms of latency.
+#define AUDIO_BUFFER_SAMPLES 256
+#define AUDIO_AMPLITUDE 4096 // Out of INT16_MAX.
+
+// The sound is rendered by snd_render() in SDL's audio callback, on its
+// own thread. The emulation thread hands it the VM's SoundState once per
+// frame, under the device lock and only when it changed.
 typedef struct {
-    Mix_Chunk* beep_sound;
+    SDL_AudioDeviceID device; // 0 when there's no audio.
+    SoundState st; // Written under the lock, read by the callback.
+    SoundVoice voice; // Callback side.
 } AudioPlayer;
 
-void audiopl_init(AudioPlayer* audiopl);
+// SDL audio must already be initialized, false when there's no audio
+// (the sound is then silently dropped).
+bool audiopl_init(AudioPlayer* audiopl);
 void audiopl_deinit(AudioPlayer* audiopl);
-void audiopl_play_beep_sound(AudioPlayer* audiopl);
+// Meant to be called once per frame from a single thread, the sound
+// starts, stops or changes with the next callback.
+void audiopl_set_sound(AudioPlayer* audiopl, const SoundState* st);
 
 #endif
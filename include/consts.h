@@ -9,8 +9,11 @@
 #define PIXEL_SCALE_FACTOR 10
 #define WINDOW_WIDTH (CHIP8_SCREEN_WIDTH * PIXEL_SCALE_FACTOR)
 #define WINDOW_HEIGHT (CHIP8_SCREEN_HEIGHT * PIXEL_SCALE_FACTOR)
-#define CPU_CLOCK_DELAY 1 // 1ms.
-#define TIMER_CLOCK_DIVISION 9
+// Timers tick, input gets polled and the screen presented once per frame.
+#define FRAMES_PER_SECOND 60
+#define DEFAULT_INSTRUCTIONS_PER_FRAME 9
+// Keeps what two threads write apart, no false sharing.
+#define CACHE_LINE_SIZE 64
 // CPU's PC starts at 0x200(512).
 #define CPU_INTERNAL_PROGRAM_COUNTER_START 0x200
 
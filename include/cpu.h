@@ -4,33 +4,116 @@
 #ifndef CPU_H
 #define CPU_H
 
+#include <stddef.h>
 #include <stdint.h>
-#include "audio.h"
+#include "consts.h"
 #include "render_engine.h"
 #include "mem.h"
-
-typedef enum {
-    KEY_PRESSED = 1,
-    KEY_NOT_PRESSED = 0,
-} KeyState;
+#include "decoder.h"
+#include "quirks.h"
+#include "sound.h"
+#include "trap.h"
 
 #define REGS_COUNT 16
 #define KEYS_COUNT 16
+#define CPU_STACK_DEPTH 16
+// Cxkk's generator seed until cpu_seed_rng() says otherwise.
+#define CPU_DEFAULT_RNG_SEED 0x43564D38ULL // "CVM8".
+// Where a trap or an Fx0A halt parks the PC, see cpu_fetch_decoded_op().
+#define CPU_PARKED_PC 0xFFFF
+
+// Fx0A, COSMAC VIP style : wait for a key to go down, then for that same
+// key to come back up, Vx gets it on release.
+typedef enum {
+    KEY_WAIT_NONE = 0,
+    KEY_WAIT_PRESS,
+    KEY_WAIT_RELEASE,
+} KeyWaitState;
 
+// Plain data, no pointer nor allocation, copied and hashed as bytes.
+// What every instruction touches comes first and fits one cache line.
 typedef struct {
-    uint8_t v_regs[REGS_COUNT]; // V Registers V0 -> VF.
-    uint16_t* stack;
-    KeyState keys[KEYS_COUNT];
-    uint16_t index_reg;
-    uint8_t delay_tm; // Delay Timer.
-    uint8_t sound_tm; // Sound Timer.
+    _Alignas(CACHE_LINE_SIZE) uint8_t v_regs[REGS_COUNT]; // V Registers V0 -> VF.
     uint16_t pc; // Program Counter.
+    uint16_t index_reg;
+    uint16_t keys; // Bit k set while key k is down.
+    uint16_t parked_pc; // PC of the instruction that parked it.
+    uint8_t sp; // Stack entries in use.
+    uint8_t trap; // CpuTrap raised by the current step.
+    uint8_t key_wait; // KeyWaitState, the CPU is halted unless KEY_WAIT_NONE.
+    uint8_t key_wait_reg; // Fx0A's x.
+    uint8_t key_wait_key; // Key awaited in KEY_WAIT_RELEASE.
+    uint8_t audio_pitch; // XO-CHIP, set by Fx3A.
+    uint8_t vblank_wait; // display_wait drew, nothing runs until the next tick.
+    // Timers are kept as the tick they reach 0 at, a tick is then a
+    // single increment and any batch size reads exact values.
+    uint64_t timer_ticks; // 60 Hz ticks so far, never goes back.
+    uint64_t delay_expiry; // Delay Timer.
+    uint64_t sound_expiry; // Sound Timer.
+    uint64_t rng_state; // xorshift64*, never 0.
+    // Cold, CALL/RET, F002 and the stats.
+    uint16_t stack[CPU_STACK_DEPTH];
+    uint8_t audio_pattern[SOUND_PATTERN_BYTES]; // XO-CHIP, loaded by F002.
+    QuirkProfile quirks;
+    uint64_t retired_ops; // Instructions run by the CpuCoreFn cores or the JIT.
+    uint64_t fused_ops; // Part of the above covered by fused ops.
+    uint64_t idle_ops; // Part of the above elided in idle loops.
 } CPU;
 
+_Static_assert(offsetof(CPU, stack) <= CACHE_LINE_SIZE, "The CPU's hot fields must fit a cache line !");
+
+// Interpreter core specialised for one QuirkProfile.
+typedef void (*CpuCoreFn)(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles);
+
+// No deinit needed, no dynamic alloc.
 void cpu_init(CPU* cpu);
-void cpu_deinit(CPU* cpu);
-void cpu_update_timers(CPU* cpu, AudioPlayer* audiopl);
+// Same seed, same Cxkk results, whatever else runs in the process.
+void cpu_seed_rng(CPU* cpu, uint64_t seed);
+
+// xorshift64*, a few cycles and its state lives in the CPU.
+static inline uint8_t cpu_next_random(CPU* cpu) {
+    uint64_t x = cpu->rng_state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    cpu->rng_state = x;
+    return (uint8_t)((x * 0x2545F4914F6CDD1DULL) >> 56);
+}
+// Advances both timers by `ticks`, returns true when a beep should
+// start (the sound timer went through 1).
+bool cpu_tick_timers(CPU* cpu, uint64_t ticks);
+
+static inline uint8_t cpu_timer_value(const CPU* cpu, uint64_t expiry) {
+    return expiry > cpu->timer_ticks ? (uint8_t)(expiry - cpu->timer_ticks) : 0;
+}
+
+static inline uint8_t cpu_delay_timer(const CPU* cpu) {
+    return cpu_timer_value(cpu, cpu->delay_expiry);
+}
+
+static inline uint8_t cpu_sound_timer(const CPU* cpu) {
+    return cpu_timer_value(cpu, cpu->sound_expiry);
+}
+// Also what resumes a CPU halted in Fx0A.
+void cpu_set_key(CPU* cpu, uint8_t key, bool pressed);
+static inline bool cpu_is_halted(const CPU* cpu) {
+    return cpu->key_wait != KEY_WAIT_NONE;
+}
 uint16_t cpu_fetch_next_op(CPU* cpu, Memory* mem);
+const DecodedOp* cpu_fetch_decoded_op(CPU* cpu, Memory* mem, DecodedOp* scratch);
+// Runs an already decoded op at cpu->pc, used by the AOT generated code.
+void cpu_execute(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op);
 void cpu_decode_and_execute(CPU* cpu, Memory* mem, RenderEngine* re);
+// Interpreter step for translated code, fused and idle slots included.
+// Returns the instructions it took out of `cycles`, never 0 nor more.
+uint32_t cpu_run_fallback(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles);
+// Core running `cycles` instructions (fewer when display_wait ends the batch
+// early, or a trap stops it), threaded when built with USE_THREADED_DISPATCH.
+// Pick it once, emu_run_batch() calls it between the two below.
+CpuCoreFn cpu_select_core(QuirkProfile quirks);
+// Brackets any kind of step (cores, JIT, AOT), the end puts a parked PC
+// back on its instruction and returns the trap if one got raised.
+void cpu_begin_step(CPU* cpu);
+CpuTrap cpu_end_step(CPU* cpu);
 
 #endif
@@ -0,0 +1,222 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+// Interpreter core template, only meant to be included by cpu.c, once per
+// quirk combination with CPU_CORE_BITS set (see QUIRKS_FROM_BITS).
+// Defines cpu_core_<CPU_CORE_BITS>(), a CpuCoreFn.
+#ifndef CPU_CORE_BITS
+#error "CPU_CORE_BITS must be defined before including cpu_core_template.h !"
+#endif
+
+#define CPU_CORE_CONCAT_(a, b) a##b
+#define CPU_CORE_CONCAT(a, b) CPU_CORE_CONCAT_(a, b)
+#define CPU_CORE_NAME CPU_CORE_CONCAT(cpu_core_, CPU_CORE_BITS)
+#define CPU_CORE_QUIRKS QUIRKS_FROM_BITS(CPU_CORE_BITS)
+
+// display_wait: a draw ends the batch, the rest of it never retires and
+// the emulator runs nothing more until the next tick.
+#define CPU_CORE_END_BATCH() \
+    do { \
+        cpu->retired_ops -= cycles; \
+        cycles = 0; \
+        cpu->vblank_wait = 1; \
+    } while (0)
+
+#ifdef CVM8_THREADED_DISPATCH
+
+// GCC/Clang labels-as-values core, every handler jumps straight
+// to the next one so each gets its own indirect branch.
+static void CPU_CORE_NAME(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles) {
+    cpu->retired_ops += cycles;
+
+    static const void* const dispatch_table[OP_HANDLERS_COUNT] = {
+        [OP_UNDECODED] = &&op_unknown, // Never returned by cpu_fetch_decoded_op().
+        [OP_CLS] = &&op_cls,
+        [OP_RET] = &&op_ret,
+        [OP_JP_ADDR] = &&op_jp_addr,
+        [OP_CALL_ADDR] = &&op_call_addr,
+        [OP_SE_VX_BYTE] = &&op_se_vx_byte,
+        [OP_SNE_VX_BYTE] = &&op_sne_vx_byte,
+        [OP_SE_VX_VY] = &&op_se_vx_vy,
+        [OP_LD_VX_BYTE] = &&op_ld_vx_byte,
+        [OP_ADD_VX_BYTE] = &&op_add_vx_byte,
+        [OP_LD_VX_VY] = &&op_ld_vx_vy,
+        [OP_OR_VX_VY] = &&op_or_vx_vy,
+        [OP_AND_VX_VY] = &&op_and_vx_vy,
+        [OP_XOR_VX_VY] = &&op_xor_vx_vy,
+        [OP_ADD_VX_VY] = &&op_add_vx_vy,
+        [OP_SUB_VX_VY] = &&op_sub_vx_vy,
+        [OP_SHR_VX] = &&op_shr_vx,
+        [OP_SUBN_VX_VY] = &&op_subn_vx_vy,
+        [OP_SHL_VX] = &&op_shl_vx,
+        [OP_SNE_VX_VY] = &&op_sne_vx_vy,
+        [OP_LD_I_ADDR] = &&op_ld_i_addr,
+        [OP_JP_V0_ADDR] = &&op_jp_v0_addr,
+        [OP_RND_VX_BYTE] = &&op_rnd_vx_byte,
+        [OP_DRW_VX_VY_N] = &&op_drw_vx_vy_n,
+        [OP_SKP_VX] = &&op_skp_vx,
+        [OP_SKNP_VX] = &&op_sknp_vx,
+        [OP_LD_VX_DT] = &&op_ld_vx_dt,
+        [OP_LD_VX_K] = &&op_ld_vx_k,
+        [OP_LD_DT_VX] = &&op_ld_dt_vx,
+        [OP_LD_ST_VX] = &&op_ld_st_vx,
+        [OP_ADD_I_VX] = &&op_add_i_vx,
+        [OP_LD_F_VX] = &&op_ld_f_vx,
+        [OP_LD_B_VX] = &&op_ld_b_vx,
+        [OP_LD_MEM_I_VX] = &&op_ld_mem_i_vx,
+        [OP_LD_VX_MEM_I] = &&op_ld_vx_mem_i,
+        [OP_LD_AUDIO_I] = &&op_ld_audio_i,
+        [OP_LD_PITCH_VX] = &&op_ld_pitch_vx,
+        [OP_UNKNOWN] = &&op_unknown,
+        [OP_FUSED_LD_LDI_DRW] = &&op_fused,
+        [OP_FUSED_DT_WAIT] = &&op_fused,
+        [OP_FUSED_ADD_SE_JP] = &&op_fused,
+        [OP_FUSED_ADDI_DRW] = &&op_fused,
+        [OP_IDLE_DT_WAIT] = &&op_idle,
+        [OP_IDLE_JP_SELF] = &&op_idle,
+        [OP_TRAP] = &&op_trap,
+    };
+
+    DecodedOp scratch;
+    const DecodedOp* d_op;
+
+#define DISPATCH_NEXT() \
+    do { \
+        if (cycles-- == 0) goto budget_spent; \
+        d_op = cpu_fetch_decoded_op(cpu, mem, &scratch); \
+        goto *dispatch_table[d_op->handler]; \
+    } while (0)
+
+#define THREADED_OP(name) \
+    op_##name: \
+        cpu_op_##name(cpu, mem, re, d_op, CPU_CORE_QUIRKS); \
+        DISPATCH_NEXT();
+
+    DISPATCH_NEXT();
+
+    THREADED_OP(cls)
+    THREADED_OP(ret)
+    THREADED_OP(jp_addr)
+    THREADED_OP(call_addr)
+    THREADED_OP(se_vx_byte)
+    THREADED_OP(sne_vx_byte)
+    THREADED_OP(se_vx_vy)
+    THREADED_OP(ld_vx_byte)
+    THREADED_OP(add_vx_byte)
+    THREADED_OP(ld_vx_vy)
+    THREADED_OP(or_vx_vy)
+    THREADED_OP(and_vx_vy)
+    THREADED_OP(xor_vx_vy)
+    THREADED_OP(add_vx_vy)
+    THREADED_OP(sub_vx_vy)
+    THREADED_OP(shr_vx)
+    THREADED_OP(subn_vx_vy)
+    THREADED_OP(shl_vx)
+    THREADED_OP(sne_vx_vy)
+    THREADED_OP(ld_i_addr)
+    THREADED_OP(jp_v0_addr)
+    THREADED_OP(rnd_vx_byte)
+    THREADED_OP(skp_vx)
+    THREADED_OP(sknp_vx)
+    THREADED_OP(ld_vx_dt)
+    THREADED_OP(ld_vx_k)
+    THREADED_OP(ld_dt_vx)
+    THREADED_OP(ld_st_vx)
+    THREADED_OP(add_i_vx)
+    THREADED_OP(ld_f_vx)
+    THREADED_OP(ld_b_vx)
+    THREADED_OP(ld_mem_i_vx)
+    THREADED_OP(ld_vx_mem_i)
+    THREADED_OP(ld_audio_i)
+    THREADED_OP(ld_pitch_vx)
+    THREADED_OP(unknown)
+
+op_drw_vx_vy_n:
+    cpu_op_drw_vx_vy_n(cpu, mem, re, d_op, CPU_CORE_QUIRKS);
+    if (CPU_CORE_QUIRKS.display_wait) CPU_CORE_END_BATCH();
+    DISPATCH_NEXT();
+
+op_fused:
+    // cycles already accounts for this instruction.
+    if (cycles + 1 >= FUSED_MAX_OPS) {
+        uint8_t retired = cpu_execute_fused(cpu, mem, re, d_op, CPU_CORE_QUIRKS);
+        cycles -= retired - 1;
+        // A trailing DRW that trapped never retired, op_trap takes it back.
+        cpu->fused_ops += retired - (cpu->trap != CPU_TRAP_NONE);
+        if (CPU_CORE_QUIRKS.display_wait && cpu_fused_op_draws(d_op->handler)) CPU_CORE_END_BATCH();
+    } else {
+        cpu_execute_quirks(cpu, mem, re, d_op, CPU_CORE_QUIRKS);
+    }
+    DISPATCH_NEXT();
+
+op_idle:
+    cycles -= cpu_run_idle_loop(cpu, mem, re, d_op, cycles + 1) - 1;
+    DISPATCH_NEXT();
+
+op_trap:
+    // Sentinel, the rest of the budget never runs, nor did the faulting
+    // instruction retire (an Fx0A halt did).
+    cpu->retired_ops -= cycles + 1 + (cpu->trap != CPU_TRAP_NONE);
+    return;
+
+budget_spent:
+    // The last instruction of the budget may have trapped.
+    cpu->retired_ops -= cpu->trap != CPU_TRAP_NONE;
+    return;
+
+#undef THREADED_OP
+#undef DISPATCH_NEXT
+}
+
+#else
+
+// Portable fallback, same handlers behind the switch.
+static void CPU_CORE_NAME(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles) {
+    cpu->retired_ops += cycles;
+
+    while (cycles > 0) {
+        DecodedOp scratch;
+        const DecodedOp* d_op = cpu_fetch_decoded_op(cpu, mem, &scratch);
+        bool drew;
+
+        // Fused ops only run whole, never past the budget, idle loops fit
+        // any budget. The trap sentinel sits after them so it costs
+        // nothing here.
+        if (d_op->handler >= OP_FUSED_FIRST && (cycles >= FUSED_MAX_OPS || d_op->handler >= OP_IDLE_FIRST)) {
+            if (d_op->handler == OP_TRAP) {
+                // Nor did the faulting instruction retire (an Fx0A halt did).
+                cpu->retired_ops -= cycles + (cpu->trap != CPU_TRAP_NONE);
+                return;
+            }
+
+            if (d_op->handler >= OP_IDLE_FIRST) {
+                cycles -= cpu_run_idle_loop(cpu, mem, re, d_op, cycles);
+                continue;
+            }
+
+            uint8_t retired = cpu_execute_fused(cpu, mem, re, d_op, CPU_CORE_QUIRKS);
+            cycles -= retired;
+            // A trailing DRW that trapped never retired, see below.
+            cpu->fused_ops += retired - (cpu->trap != CPU_TRAP_NONE);
+            drew = cpu_fused_op_draws(d_op->handler);
+        } else {
+            cpu_execute_quirks(cpu, mem, re, d_op, CPU_CORE_QUIRKS);
+            cycles--;
+            drew = d_op->handler == OP_DRW_VX_VY_N;
+        }
+
+        if (CPU_CORE_QUIRKS.display_wait && drew) CPU_CORE_END_BATCH();
+    }
+
+    // The last instruction of the budget may have trapped.
+    cpu->retired_ops -= cpu->trap != CPU_TRAP_NONE;
+}
+
+#endif
+
+#undef CPU_CORE_END_BATCH
+#undef CPU_CORE_QUIRKS
+#undef CPU_CORE_NAME
+#undef CPU_CORE_CONCAT
+#undef CPU_CORE_CONCAT_
+#undef CPU_CORE_BITS
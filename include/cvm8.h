@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef CVM8_H
+#define CVM8_H
+
+// Public API of the cvm8core library, no SDL in here.
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "quirks.h"
+#include "render_engine.h"
+#include "sound.h"
+#include "trap.h"
+
+#define CVM8_KEYS_COUNT 16
+
+typedef struct Cvm8 Cvm8;
+
+// Called from cvm8_step() when a beep starts.
+typedef void (*Cvm8BeepFn)(void* user_data);
+
+// NULL when out of memory.
+Cvm8* cvm8_create(QuirkProfile quirks);
+void cvm8_destroy(Cvm8* vm);
+
+// false on an oversized or unreadable ROM.
+bool cvm8_load_rom(Cvm8* vm, const uint8_t* rom_buf, size_t rom_size);
+bool cvm8_load_rom_from_file(Cvm8* vm, const char* rom_path);
+
+// Cxkk results only depend on the seed, a fixed one until this is called.
+void cvm8_seed_rng(Cvm8* vm, uint64_t seed);
+// Instructions per 60 Hz timer tick, DEFAULT_INSTRUCTIONS_PER_FRAME until
+// this is called (before the first step), 0 counts as 1. A save state
+// brings its own back.
+void cvm8_set_ipf(Cvm8* vm, uint32_t ipf);
+uint32_t cvm8_get_ipf(const Cvm8* vm);
+
+// Runs until the budget is spent or a trap is raised. On a trap the PC is
+// left on the faulting instruction and stepping again raises it again.
+CpuTrap cvm8_step(Cvm8* vm, uint32_t cycles);
+// Emulated time, the sum of every cvm8_step() budget so far. Frame f of a
+// run at ipf instructions per frame starts at cycle f * ipf, the timers
+// tick right as it does : one cvm8_step(n * ipf) is n cvm8_step(ipf).
+uint64_t cvm8_get_cycle(const Cvm8* vm);
+uint16_t cvm8_get_pc(const Cvm8* vm);
+// Waiting in Fx0A, cvm8_step() runs nothing until a key goes down then up.
+bool cvm8_is_halted(const Cvm8* vm);
+// `frames` x cvm8_step(ipf) in one go, only while halted with no key
+// pending, false then nothing moved.
+bool cvm8_skip_halted_frames(Cvm8* vm, uint32_t frames);
+// Sound timer still running.
+bool cvm8_is_sound_on(const Cvm8* vm);
+// XO-CHIP pattern and pitch plus the above, render it with snd_render().
+void cvm8_get_sound(const Cvm8* vm, SoundState* st);
+
+// Packed rows plus their generation, see RenderEngine.
+const RenderEngine* cvm8_framebuffer(const Cvm8* vm);
+// Rows changed since the previous call (all of them on the first one),
+// for a single presenting consumer, the machine state never sees it.
+uint32_t cvm8_take_dirty_rows(Cvm8* vm);
+bool cvm8_is_pixel_on(const Cvm8* vm, uint8_t x, uint8_t y);
+
+// key in 0x0 -> 0xF, also resumes a halted VM.
+void cvm8_set_key(Cvm8* vm, uint8_t key, bool pressed);
+// Same, applied by cvm8_step() right before the instruction at `cycle`
+// runs, or when the next step starts if that's already past. Stamps must
+// not go down from one call to the next. false when the queue is full.
+bool cvm8_queue_key(Cvm8* vm, uint64_t cycle, uint8_t key, bool pressed);
+// Queued key events not applied yet.
+uint32_t cvm8_pending_keys(const Cvm8* vm);
+void cvm8_set_beep_callback(Cvm8* vm, Cvm8BeepFn on_beep, void* user_data);
+
+void cvm8_print_fusion_report(Cvm8* vm, const char* rom_path);
+
+// The machine state is a fixed-size plain struct, copying one VM into
+// another is a memcpy (the callbacks stay dst's own) and two VMs in the
+// same state hash the same. dst takes src's quirks along.
+void cvm8_copy_state(Cvm8* dst, const Cvm8* src);
+uint64_t cvm8_hash_state(const Cvm8* vm);
+// Checkpoint and resume through a versioned file (see savestate.h) : the
+// whole machine, quirks included, and the ROM is in its memory so loading
+// needs none. false with the VM untouched when the file can't be used.
+bool cvm8_save_state(const Cvm8* vm, const char* path);
+bool cvm8_load_state(Cvm8* vm, const char* path);
+
+#endif
@@ -0,0 +1,85 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef DECODER_H
+#define DECODER_H
+
+#include <stdint.h>
+
+// One ID per instruction, OP_UNDECODED must stay 0 so
+// a zeroed slot means "decode me".
+typedef enum {
+    OP_UNDECODED = 0,
+    OP_CLS,
+    OP_RET,
+    OP_JP_ADDR,
+    OP_CALL_ADDR,
+    OP_SE_VX_BYTE,
+    OP_SNE_VX_BYTE,
+    OP_SE_VX_VY,
+    OP_LD_VX_BYTE,
+    OP_ADD_VX_BYTE,
+    OP_LD_VX_VY,
+    OP_OR_VX_VY,
+    OP_AND_VX_VY,
+    OP_XOR_VX_VY,
+    OP_ADD_VX_VY,
+    OP_SUB_VX_VY,
+    OP_SHR_VX,
+    OP_SUBN_VX_VY,
+    OP_SHL_VX,
+    OP_SNE_VX_VY,
+    OP_LD_I_ADDR,
+    OP_JP_V0_ADDR,
+    OP_RND_VX_BYTE,
+    OP_DRW_VX_VY_N,
+    OP_SKP_VX,
+    OP_SKNP_VX,
+    OP_LD_VX_DT,
+    OP_LD_VX_K,
+    OP_LD_DT_VX,
+    OP_LD_ST_VX,
+    OP_ADD_I_VX,
+    OP_LD_F_VX,
+    OP_LD_B_VX,
+    OP_LD_MEM_I_VX,
+    OP_LD_VX_MEM_I,
+    OP_LD_AUDIO_I, // XO-CHIP F002.
+    OP_LD_PITCH_VX, // XO-CHIP Fx3A.
+    OP_UNKNOWN,
+    // Superinstructions, only produced by decoder_fuse_ops(). They read
+    // their tail operands from the slots right after theirs.
+    OP_FUSED_LD_LDI_DRW, // 6xkk, Annn, Dxyn.
+    OP_FUSED_DT_WAIT, // Fx07, 3xkk, 1nnn.
+    OP_FUSED_ADD_SE_JP, // 7xkk, 3xkk, 1nnn.
+    OP_FUSED_ADDI_DRW, // Fx1E, Dxyn.
+    // Loops jumping back to their own first op that can't leave before
+    // the next timer tick, the cores retire the rest of the budget at once.
+    OP_IDLE_DT_WAIT, // Fx07, 3xkk, 1nnn with nnn its own address.
+    OP_IDLE_JP_SELF, // 1nnn with nnn its own address.
+    // Sentinel returned by cpu_fetch_decoded_op() once a trap got raised,
+    // never stored in a slot.
+    OP_TRAP,
+    OP_HANDLERS_COUNT,
+} OpHandler;
+
+#define OP_FUSED_FIRST OP_FUSED_LD_LDI_DRW
+#define OP_IDLE_FIRST OP_IDLE_DT_WAIT
+#define FUSED_MAX_OPS 3
+
+// Opcode with its operands already extracted, 8 bytes.
+typedef struct {
+    uint16_t op; // Raw opcode, kept for error reporting.
+    uint16_t nnn;
+    uint8_t handler; // OpHandler.
+    uint8_t nn;
+    uint8_t x;
+    uint8_t y;
+} DecodedOp;
+
+DecodedOp decoder_decode_op(uint16_t op);
+// Fused handler for the sequence starting at first, or first->handler.
+// addr is where first sits, to spot loops jumping back to it.
+OpHandler decoder_fuse_ops(const DecodedOp* first, const DecodedOp* second, const DecodedOp* third, uint16_t addr);
+
+#endif
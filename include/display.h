@@ -0,0 +1,46 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef DISPLAY_H
+#define DISPLAY_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <SDL2/SDL.h>
+#include "render_engine.h"
+#include "scaler.h"
+#include "phosphor.h"
+
+#define DISPLAY_COLOR_ON 0xFFFFFFFF // ARGB8888.
+#define DISPLAY_COLOR_OFF 0xFF000000
+
+// Host side of the screen, the framebuffer is streamed into a CHIP-8
+// sized texture (times the filter factor) and the renderer scales it
+// to the window.
+typedef struct {
+    SDL_Window* window;
+    SDL_Renderer* renderer;
+    SDL_Texture* texture;
+    ScalerFilter filter;
+    bool persistence; // Shows phos instead of the raw framebuffer, no filter then.
+    Phosphor phos;
+    uint32_t palette[PHOSPHOR_FULL_INTENSITY + 1]; // Intensity to color.
+    bool needs_present; // Set when the window lost its content.
+    uint64_t frames_presented;
+    uint64_t frames_skipped; // Nothing changed, nothing uploaded nor presented.
+    uint64_t rows_uploaded;
+} Display;
+
+// SDL video must already be initialized, returns false on failure
+// with nothing left to free.
+bool disp_init(Display* disp, const char* title, ScalerFilter filter, bool persistence);
+void disp_deinit(Display* disp);
+// Meant to be called once per frame with the rows that changed since
+// the last call, only uploads those and does nothing at all when none did
+// (fading rows included), false then.
+bool disp_present(Display* disp, const RenderEngine* re, uint32_t dirty_rows);
+// Forces the next disp_present(), e.g. after the window got exposed.
+void disp_invalidate(Display* disp);
+void disp_print_stats(Display* disp);
+
+#endif
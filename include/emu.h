@@ -4,47 +4,82 @@
 #ifndef EMU_H
 #define EMU_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include "consts.h"
 #include "mem.h"
-#include "audio.h"
 #include "cpu.h"
 #include "render_engine.h"
+#include "key_events.h"
+#include "jit.h"
+#include "aot.h"
 
+// Called by the step whose cycle reaches the tick a beep starts on.
+typedef void (*EmuBeepFn)(void* user_data);
+
+// Everything the emulated machine is, a fixed-size plain struct with no
+// pointer in it : a memcpy copies an instance, hashing its bytes compares
+// two, nothing in here ever allocates. Hot first, the predecoded slots
+// in mem (derived from mem.mem, still valid once copied) last.
 typedef struct {
-    AudioPlayer audiopl;
-    Memory mem;
     CPU cpu;
     RenderEngine re;
-} Emulator;
+    // Emulated time in instructions, every step moves it by its whole
+    // budget, retired or not (halts, display_wait, traps). The 60 Hz
+    // timers follow it, cpu.timer_ticks is cycle / ipf once a step ends.
+    uint64_t cycle;
+    uint32_t ipf; // Instructions per timer tick, never 0.
+    KeyEventQueue key_events; // Applied by emu_do_cpu_cycles() at their stamps.
+    Memory mem;
+} MachineState;
 
-#define MAX_ROM_SIZE (0xFFF - CPU_INTERNAL_PROGRAM_COUNTER_START)
-#define FONTSET_SIZE 80
-static uint8_t FONTSET[FONTSET_SIZE] = {
-    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
-    0x20, 0x60, 0x20, 0x20, 0x70, // 1
-    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
-    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
-    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
-    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
-    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
-    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
-    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
-    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
-    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
-    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
-    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
-    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
-    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
-    0xF0, 0x80, 0xF0, 0x80, 0x80, // F
-};
+// What's hashed and saved : everything but the predecoded slots (and the
+// JIT's code map), those only cache what mem.mem holds.
+#define MACHINE_STATE_SAVED_SIZE (offsetof(MachineState, mem) + offsetof(Memory, decoded_ops))
+
+// The machine plus what the host hangs off it, never part of a copy.
+typedef struct {
+    MachineState state;
+    CpuCoreFn cpu_core; // Picked once from state.cpu.quirks.
+    EmuBeepFn on_beep; // Optional.
+    void* beep_user_data;
+#ifdef CVM8_JIT
+    Jit jit;
+#endif
+} Emulator;
 
-void emu_init(Emulator* emu);
+void emu_init(Emulator* emu, QuirkProfile quirks);
 void emu_deinit(Emulator* emu);
-void emu_load_rom_from_file(Emulator* emu, char* rom_path);
+bool emu_load_rom(Emulator* emu, const uint8_t* rom_buf, size_t rom_size);
+bool emu_load_rom_from_file(Emulator* emu, const char* rom_path);
 bool emu_re_is_pixel_on(Emulator* emu, uint8_t x, uint8_t y);
-void emu_update_cpu_timers(Emulator* emu);
-void emu_do_cpu_cycle(Emulator* emu);
+// Changes whenever the screen does, see RenderEngine.generation.
+uint64_t emu_re_generation(Emulator* emu);
+void emu_set_key(Emulator* emu, uint8_t key, bool pressed);
+// false when the queue is full, stamps already past apply at the next step.
+bool emu_queue_key(Emulator* emu, uint64_t cycle, uint8_t key, bool pressed);
+// 0 counts as 1. Meant before the first step, the timers are cycle / ipf.
+void emu_set_ipf(Emulator* emu, uint32_t ipf);
+// Runs until the budget is spent or a trap is raised, the PC is then left
+// on the trapping instruction. Queued key events due within the budget
+// split it and apply right before the instruction at their stamp, timer
+// ticks split it too : however the budget is cut, the run is the same.
+CpuTrap emu_do_cpu_cycle(Emulator* emu);
+CpuTrap emu_do_cpu_cycles(Emulator* emu, uint32_t cycles);
+// Same as `frames` steps of ipf cycles each, in O(1). Only while halted
+// in Fx0A with no key queued, false otherwise.
+bool emu_skip_halted_frames(Emulator* emu, uint32_t frames);
+void emu_print_fusion_report(Emulator* emu, const char* rom_path);
+// Overwrites dst's machine with src's, quirks included, the host side
+// (JIT, beep callback) stays dst's own and its core follows the quirks.
+void emu_copy_state(Emulator* dst, const Emulator* src);
+// FNV-1a style over the machine minus the predecoded slots.
+uint64_t emu_hash_state(const Emulator* emu);
+// See savestate.h for the format. false, with emu untouched, when the file
+// can't be written/read or isn't a valid save state for this build. A load
+// brings the quirks back too, the core follows them.
+bool emu_save_state(const Emulator* emu, const char* path);
+bool emu_load_state(Emulator* emu, const char* path);
 
 #endif
@@ -0,0 +1,47 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef INPUT_QUEUE_H
+#define INPUT_QUEUE_H
+
+// Single producer single consumer ring, lock-free, carrying host input
+// from the thread polling events to the emulation thread.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "consts.h"
+
+#define INQ_CAPACITY 256 // Power of two.
+
+typedef enum {
+    INPUT_EVENT_KEY,
+    INPUT_EVENT_TURBO, // Toggles turbo.
+    INPUT_EVENT_SAVE_STATE, // At the start of the next frame.
+    INPUT_EVENT_LOAD_STATE,
+} InputEventType;
+
+typedef struct {
+    uint64_t time_ns; // When the host saw it, on sched_now_ns()'s clock.
+    uint8_t type;
+    uint8_t key; // 0x0 -> 0xF.
+    bool pressed;
+} InputEvent;
+
+typedef struct {
+    InputEvent events[INQ_CAPACITY];
+    // Free running, wrapped on access.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t head; // Next one to pop.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint32_t tail; // Next one to push.
+    uint64_t dropped; // Producer side.
+} InputQueue;
+
+void inq_init(InputQueue* inq);
+// Producer, false (and the event dropped) when full.
+bool inq_push(InputQueue* inq, InputEvent ev);
+// Consumer, false when empty.
+bool inq_pop(InputQueue* inq, InputEvent* ev);
+// Consumer, same without taking it.
+bool inq_peek(InputQueue* inq, InputEvent* ev);
+
+#endif
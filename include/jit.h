@@ -0,0 +1,53 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef JIT_H
+#define JIT_H
+
+// x86-64 Linux only, enabled with USE_X86_64_JIT.
+#ifdef CVM8_JIT
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cpu.h"
+#include "mem.h"
+#include "render_engine.h"
+
+#define JIT_CODE_ARENA_SIZE (1 << 20) // 1MB of RWX memory.
+#define JIT_MAX_BLOCK_OPS 32
+#define JIT_MAX_BLOCK_BYTES 4096
+
+typedef void (*JitBlockFn)(CPU* cpu);
+
+typedef enum {
+    JIT_BLOCK_EMPTY = 0, // Not translated yet.
+    JIT_BLOCK_READY,
+    JIT_BLOCK_INTERPRET, // First op can't be translated, let the interpreter run it.
+} JitBlockState;
+
+typedef struct {
+    JitBlockFn fn;
+    uint16_t start;
+    uint16_t end; // One past the last translated byte.
+    uint8_t op_count; // Instructions retired by one call of fn.
+    uint8_t state; // JitBlockState.
+} JitBlock;
+
+typedef struct {
+    uint8_t* code;
+    size_t code_used;
+    // One block per even PC, same indexing as Memory.decoded_ops.
+    JitBlock blocks[DECODED_OPS_COUNT];
+} Jit;
+
+void jit_init(Jit* jit);
+void jit_deinit(Jit* jit);
+// Drops every block, e.g. once mem got replaced as a whole.
+void jit_flush_all(Jit* jit, Memory* mem);
+// Same contract as a CpuCoreFn, exactly `cycles` instructions get retired.
+// Blocks call back into the interpreter for DRW, CALL/RET, memory and key ops.
+void jit_run_cycles(Jit* jit, CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles);
+
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef KEY_EVENTS_H
+#define KEY_EVENTS_H
+
+// Keypad transitions stamped with the emulated cycle they apply at, a
+// step runs up to the stamp, applies the transition, then goes on. The
+// same stamped input always gives the same run, whatever the batch size
+// or when the host delivered it.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define KEY_EVENTS_CAPACITY 64 // Power of two.
+
+typedef struct {
+    uint64_t cycle; // See Emulator.cycle.
+    uint8_t key; // 0x0 -> 0xF.
+    bool pressed;
+} KeyEvent;
+
+// Single threaded ring, stamps never go down from one event to the next.
+typedef struct {
+    KeyEvent events[KEY_EVENTS_CAPACITY];
+    uint32_t head;
+    uint32_t tail;
+    uint64_t last_cycle; // Stamp of the last pushed event.
+} KeyEventQueue;
+
+void kevq_init(KeyEventQueue* kevq);
+// false when full. A stamp below the last pushed one gets raised to it,
+// transitions always apply in the order they were pushed.
+bool kevq_push(KeyEventQueue* kevq, KeyEvent ev);
+// false when empty.
+bool kevq_peek(const KeyEventQueue* kevq, KeyEvent* ev);
+void kevq_drop(KeyEventQueue* kevq);
+uint32_t kevq_count(const KeyEventQueue* kevq);
+
+#endif
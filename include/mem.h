@@ -4,17 +4,40 @@
 #ifndef MEM_H
 #define MEM_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "consts.h"
+#include "decoder.h"
 
 #define TOTAL_MEMORY_SIZE 0x1000
 
+#define MAX_ROM_SIZE (0xFFF - CPU_INTERNAL_PROGRAM_COUNTER_START)
+#define FONTSET_SIZE 80
+
+// One predecoded slot per even address.
+#define DECODED_OPS_COUNT (TOTAL_MEMORY_SIZE / 2)
+
 typedef struct {
     uint8_t mem[TOTAL_MEMORY_SIZE];
+    // Filled lazily by the CPU, every write invalidates the
+    // slot it lands in so self-modifying ROMs stay correct.
+    DecodedOp decoded_ops[DECODED_OPS_COUNT];
+#ifdef CVM8_JIT
+    // Slots covered by translated blocks, a write to one of them
+    // records the dirty range so the JIT drops stale blocks.
+    uint8_t code_map[DECODED_OPS_COUNT];
+    bool code_dirty;
+    uint16_t code_dirty_lo;
+    uint16_t code_dirty_hi;
+#endif
 } Memory;
 
 // No deinit function needed, no dynamic alloc.
 void mem_init(Memory* mem);
 uint8_t mem_read(Memory* mem, uint16_t addr);
 void mem_write(Memory* mem, uint16_t addr, uint8_t value);
+// FONTSET at 0x000, ROM at 0x200, the size must already be checked.
+void mem_load_rom(Memory* mem, const uint8_t* rom_buf, size_t rom_size);
 
 #endif
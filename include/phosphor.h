@@ -0,0 +1,26 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef PHOSPHOR_H
+#define PHOSPHOR_H
+
+#include <stdint.h>
+#include "consts.h"
+#include "render_engine.h"
+
+#define PHOSPHOR_FULL_INTENSITY 255
+#define PHOSPHOR_DEFAULT_DECAY 160 // Intensity kept per frame, out of 256.
+
+// Fakes a CRT's phosphor persistence to hide XOR sprite flicker, lit
+// pixels snap to full intensity and fade out over the next frames.
+typedef struct {
+    uint8_t intensity[CHIP8_SCREEN_HEIGHT][CHIP8_SCREEN_WIDTH];
+    uint8_t decay;
+} Phosphor;
+
+void phos_init(Phosphor* phos, uint8_t decay);
+// Once per frame, built with SSE2 or AVX2 intrinsics when the target
+// has them. Returns the rows whose intensities changed, one bit per row.
+uint32_t phos_update(Phosphor* phos, const RenderEngine* re);
+
+#endif
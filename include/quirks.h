@@ -0,0 +1,42 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef QUIRKS_H
+#define QUIRKS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Behaviours that differ between CHIP-8 interpreters, all false
+// means the behaviour CVM8_CV always had.
+typedef struct {
+    bool shift_vy; // 8xy6/8xyE shift Vy into Vx instead of shifting Vx.
+    bool load_store_inc_i; // Fx55/Fx65 leave I at I + x + 1.
+    bool clip_sprites; // DRW clips at the screen edges instead of wrapping.
+    bool vf_reset; // 8xy1/8xy2/8xy3 reset VF.
+    bool display_wait; // DRW waits for the next frame, ends the current batch.
+} QuirkProfile;
+
+#define QUIRKS_COUNT 5
+#define QUIRK_COMBINATIONS_COUNT (1 << QUIRKS_COUNT)
+#define QUIRKS_DEFAULT ((QuirkProfile){ false, false, false, false, false })
+
+// One bit per quirk, in declaration order.
+#define QUIRKS_FROM_BITS(bits) ((QuirkProfile){ \
+    .shift_vy = ((bits) & 0x01) != 0, \
+    .load_store_inc_i = ((bits) & 0x02) != 0, \
+    .clip_sprites = ((bits) & 0x04) != 0, \
+    .vf_reset = ((bits) & 0x08) != 0, \
+    .display_wait = ((bits) & 0x10) != 0, \
+})
+
+static inline uint8_t quirks_to_bits(QuirkProfile quirks) {
+    return quirks.shift_vy << 0 | quirks.load_store_inc_i << 1 | quirks.clip_sprites << 2
+        | quirks.vf_reset << 3 | quirks.display_wait << 4;
+}
+
+static inline bool quirks_are_default(QuirkProfile quirks) {
+    return quirks_to_bits(quirks) == 0;
+}
+
+#endif
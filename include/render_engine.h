@@ -13,16 +13,41 @@ typedef enum {
     PIXEL_OFF = 0,
 } PixelState;
 
-#define RENDER_TABLE_SIZE (CHIP8_SCREEN_WIDTH * CHIP8_SCREEN_HEIGHT)
+_Static_assert(CHIP8_SCREEN_WIDTH == 64, "A framebuffer row must fit a uint64_t !");
+_Static_assert(CHIP8_SCREEN_HEIGHT == 32, "The dirty rows must fit a uint32_t !");
 
+#define RE_ALL_ROWS_DIRTY UINT32_MAX
+
+// One bit per pixel, x = 0 is the most significant bit of its row.
 typedef struct {
-    PixelState render_table[RENDER_TABLE_SIZE];
+    uint64_t rows[CHIP8_SCREEN_HEIGHT];
+    uint64_t generation; // Bumped on every change, compare it to know if a new frame exists.
 } RenderEngine;
 
 // No deinit needed, no dynamic alloc.
 void re_init(RenderEngine* re);
-bool re_is_pixel_on(RenderEngine* re, uint8_t x, uint8_t y);
+bool re_is_pixel_on(const RenderEngine* re, uint8_t x, uint8_t y);
 void re_change_pixel_state_to(RenderEngine* re, uint8_t x, uint8_t y, PixelState new_state);
 void re_clear(RenderEngine* re);
+// Rows that differ between two framebuffers, one bit per row, what a
+// consumer compares against the last frame it presented.
+uint32_t re_diff_rows(const RenderEngine* a, const RenderEngine* b);
+
+// Sprite byte moved to column x as a row mask, wrapping around
+// the right edge or dropping what falls past it when clipping.
+static inline uint64_t re_sprite_row_mask(uint8_t sprite_byte, uint8_t x, bool clip) {
+    uint64_t row = (uint64_t)sprite_byte << 56;
+    x %= CHIP8_SCREEN_WIDTH;
+    if (clip) return row >> x;
+    return (row >> x) | (row << ((CHIP8_SCREEN_WIDTH - x) & 63));
+}
+
+// XORs a mask into row y, returns true on collision.
+static inline bool re_xor_row(RenderEngine* re, uint8_t y, uint64_t mask) {
+    uint64_t collided = re->rows[y] & mask;
+    re->rows[y] ^= mask;
+    re->generation += mask != 0;
+    return collided != 0;
+}
 
 #endif
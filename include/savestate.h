@@ -0,0 +1,45 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+// Save state file : a SaveStateHeader then the first MACHINE_STATE_SAVED_SIZE
+// bytes of a MachineState, as the core lays them out. Everything in it is
+// little-endian, a big-endian host refuses to write or read one. Loading
+// is a single read, the checks below and a memcpy, the predecoded slots
+// refill lazily and the JIT starts over.
+
+#include <stddef.h>
+#include <stdint.h>
+#include "emu.h"
+
+#define SAVESTATE_MAGIC "CVM8STAT" // No terminator in the file.
+#define SAVESTATE_MAGIC_SIZE 8
+// Bump on any change to the header or to what MachineState holds.
+#define SAVESTATE_VERSION 3
+
+typedef struct {
+    char magic[SAVESTATE_MAGIC_SIZE];
+    uint16_t version;
+    uint16_t header_size;
+    uint32_t payload_size;
+    // Layout of the payload, another build may pad its structs differently.
+    uint16_t cpu_size;
+    uint16_t re_size;
+    uint16_t key_events_size;
+    uint16_t mem_offset;
+    uint64_t checksum; // emu_hash_state() of the saved machine.
+} SaveStateHeader;
+
+_Static_assert(sizeof(SaveStateHeader) == 32, "The save state header must stay 32 bytes !");
+
+// The whole file, read and written in one go.
+typedef struct {
+    SaveStateHeader header;
+    uint8_t payload[MACHINE_STATE_SAVED_SIZE];
+} SaveStateFile;
+
+#define SAVESTATE_FILE_SIZE (sizeof(SaveStateHeader) + MACHINE_STATE_SAVED_SIZE)
+
+#endif
@@ -0,0 +1,35 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef SCALER_H
+#define SCALER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "render_engine.h"
+
+typedef enum {
+    SCALER_FILTER_NONE = 0, // Nearest neighbour.
+    SCALER_FILTER_SCALE2X,
+    SCALER_FILTER_SCALE3X,
+    SCALER_FILTER_EPX, // Same output as Scale2x on a 1-bit picture.
+} ScalerFilter;
+
+// Output size multiple of the filter (1, 2 or 3), any integer scale
+// that is a multiple of it works, the rest is nearest neighbour.
+uint8_t scaler_filter_factor(ScalerFilter filter);
+bool scaler_is_scale_valid(ScalerFilter filter, uint8_t scale);
+
+// Expands the framebuffer into `out`, (CHIP8_SCREEN_WIDTH * scale) x
+// (CHIP8_SCREEN_HEIGHT * scale) 32-bit pixels in whatever packed format
+// on_color/off_color use (RGBA8888, ARGB8888...), `pitch` in pixels.
+// Built with SSE2 or AVX2 intrinsics when the target has them.
+// Returns false, writing nothing, on an invalid filter/scale pair.
+bool scaler_scale(const RenderEngine* re, ScalerFilter filter, uint8_t scale, uint32_t on_color, uint32_t off_color, uint32_t* out, size_t pitch);
+// Same, only for framebuffer rows [first_row, last_row], `out` being
+// where first_row starts. Filtered rows also depend on their neighbours.
+bool scaler_scale_rows(const RenderEngine* re, ScalerFilter filter, uint8_t scale, uint32_t on_color, uint32_t off_color,
+    uint8_t first_row, uint8_t last_row, uint32_t* out, size_t pitch);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Further behind than this many frames, the schedule restarts from now
+// instead of running the missed frames back to back.
+#define SCHED_MAX_LAG_FRAMES 3
+
+// Paces the frontend at a fixed frame rate, deadlines are absolute
+// (epoch + n / fps on CLOCK_MONOTONIC) so oversleeping one frame
+// shortens the next sleep instead of drifting.
+// Turbo drops the pacing altogether, frames (timer ticks included) still
+// are emulated frames, only their wall clock duration changes.
+typedef struct {
+    uint32_t ipf; // Instructions per frame.
+    uint32_t fps;
+    bool turbo;
+    uint64_t epoch_ns;
+    uint64_t frame_index; // Since epoch_ns.
+    uint64_t last_wake_ns;
+    // Emulated over wall clock time, refreshed about once per second.
+    double speed;
+    uint64_t speed_updates;
+    uint64_t speed_window_ns;
+    uint64_t speed_window_frames;
+    uint64_t turbo_frames;
+    uint64_t turbo_ns;
+    // Stats, lateness is how long after its deadline a frame started.
+    uint64_t frames; // Paced ones only.
+    uint64_t missed_deadlines; // Already past when sched_wait_frame() got called.
+    uint64_t resyncs;
+    int64_t lateness_min_ns;
+    int64_t lateness_max_ns;
+    double lateness_mean_ns;
+    double lateness_m2; // Welford, for the standard deviation.
+    uint64_t interval_max_dev_ns; // Worst frame to frame period error.
+    // Busy is the time from a wake up to the next wait, the frame's work.
+    uint64_t busy_start_ns; // The wake up, or when sched_skip_frames() got called.
+    uint64_t busy_total_ns;
+    uint64_t busy_max_ns;
+} FrameScheduler;
+
+void sched_init(FrameScheduler* sched, uint32_t fps, uint32_t ipf);
+// CLOCK_MONOTONIC, what the deadlines and last_wake_ns are measured on.
+uint64_t sched_now_ns(void);
+// Sleeps until the next frame's deadline, returns right away in turbo.
+void sched_wait_frame(FrameScheduler* sched);
+// After blocking elsewhere, takes every deadline up to until_ns as a frame
+// woken on time and returns how many, the next wait is for the one after.
+// Nothing to skip in turbo.
+uint64_t sched_skip_frames(FrameScheduler* sched, uint64_t until_ns);
+void sched_set_turbo(FrameScheduler* sched, bool turbo);
+double sched_lateness_stddev_ns(const FrameScheduler* sched);
+// name tells the threads apart, each one paces itself.
+void sched_print_stats(const FrameScheduler* sched, const char* name);
+
+#endif
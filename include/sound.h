@@ -0,0 +1,44 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef SOUND_H
+#define SOUND_H
+
+// XO-CHIP sound, a 128 bit pattern played in a loop as a 1-bit sample
+// stream while the sound timer runs, at 4000 * 2^((pitch - 64) / 48) Hz.
+// No SDL in here, the frontend's audio callback and the headless runs
+// render through the same code.
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOUND_PATTERN_BYTES 16
+#define SOUND_PATTERN_BITS (SOUND_PATTERN_BYTES * 8)
+#define SOUND_DEFAULT_PITCH 64 // 4000 Hz.
+// Plain CHIP-8 ROMs never load a pattern, 4 bits on 4 bits off is a
+// 500 Hz square wave at the default pitch.
+#define SOUND_DEFAULT_PATTERN_BYTE 0xF0
+
+// What the VM exposes, F002 fills pattern, Fx3A sets pitch.
+typedef struct {
+    uint8_t pattern[SOUND_PATTERN_BYTES]; // Bit 7 of byte 0 plays first.
+    uint8_t pitch;
+    bool on; // Sound timer above 0.
+} SoundState;
+
+// One playback of a SoundState at a device rate.
+typedef struct {
+    uint32_t device_rate;
+    uint32_t phase; // Top 7 bits are the pattern bit being played.
+    uint32_t step; // Phase increment per output sample, for step_pitch.
+    uint8_t step_pitch;
+} SoundVoice;
+
+void snd_init_state(SoundState* st);
+void snd_voice_init(SoundVoice* voice, uint32_t device_rate);
+// Writes count mono samples, +/- amplitude while on and 0 otherwise. The
+// phase keeps going through silences, it only depends on samples rendered.
+// Blocks of 8 samples with AVX2 when the target has it.
+void snd_render(SoundVoice* voice, const SoundState* st, int16_t amplitude, int16_t* out, uint32_t count);
+
+#endif
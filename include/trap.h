@@ -0,0 +1,20 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef TRAP_H
+#define TRAP_H
+
+// Why a step stopped before running its whole budget. The CPU is left
+// on the faulting instruction, which did not retire.
+typedef enum {
+    CPU_TRAP_NONE = 0,
+    CPU_TRAP_INVALID_OPCODE,
+    CPU_TRAP_OUT_OF_RANGE, // Memory access or PC past the end of memory.
+    CPU_TRAP_STACK_UNDERFLOW, // RET with an empty stack.
+    CPU_TRAP_STACK_OVERFLOW, // CALL with CPU_STACK_DEPTH entries already.
+    CPU_TRAP_UNIMPLEMENTED_OPCODE,
+} CpuTrap;
+
+const char* cpu_trap_name(CpuTrap trap);
+
+#endif
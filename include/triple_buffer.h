@@ -0,0 +1,49 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+
+// Hands finished frames from the emulation thread to the presenting one
+// without locks. The writer always has a free slot and the reader always
+// gets the latest published frame, frames nobody read get overwritten.
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "consts.h"
+#include "render_engine.h"
+
+// Set in `middle` when it holds a frame the reader hasn't taken yet.
+#define TBUF_FRESH 0x4
+
+typedef struct {
+    RenderEngine fb;
+    uint64_t frame; // Emulated frames since the start.
+    double speed; // The emulation thread's sched speed.
+    bool turbo;
+    bool halted;
+} FrameSnapshot;
+
+typedef struct {
+    FrameSnapshot slots[3];
+    // Slot index plus TBUF_FRESH, the only thing both threads touch.
+    _Alignas(CACHE_LINE_SIZE) _Atomic uint8_t middle;
+    // Writer side.
+    _Alignas(CACHE_LINE_SIZE) uint8_t back;
+    uint64_t published;
+    // Reader side.
+    _Alignas(CACHE_LINE_SIZE) uint8_t front;
+    uint64_t taken;
+} TripleBuffer;
+
+void tbuf_init(TripleBuffer* tbuf);
+// Writer, fill the returned slot then publish it.
+FrameSnapshot* tbuf_back(TripleBuffer* tbuf);
+void tbuf_publish(TripleBuffer* tbuf);
+// Reader, swaps the latest frame in if there's one, returns false when
+// the front slot is still the latest.
+bool tbuf_take(TripleBuffer* tbuf);
+const FrameSnapshot* tbuf_front(const TripleBuffer* tbuf);
+
+#endif
@@ -3,31 +3,52 @@
 */
 #include "audio.h"
 #include <stdio.h>
+#include <string.h>
 
-void audiopl_init(AudioPlayer* audiopl) {
-    if (Mix_OpenAudio(44100, AUDIO_S16LSB, MIX_DEFAULT_CHANNELS, 2048) < 0) {
-        fprintf(stderr, "[FATAL ERROR] Unable to initialize the audio backend !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
-    }
+// Runs on SDL's audio thread with the device locked, mono S16.
+static void audiopl_fill(void* user_data, Uint8* stream, int len) {
+    AudioPlayer* audiopl = (AudioPlayer*)user_data;
+    snd_render(&audiopl->voice, &audiopl->st, AUDIO_AMPLITUDE, (int16_t*)stream, (uint32_t)len / sizeof(int16_t));
+}
+
+bool audiopl_init(AudioPlayer* audiopl) {
+    audiopl->device = 0;
+    snd_init_state(&audiopl->st);
 
-    audiopl->beep_sound = Mix_LoadWAV("beep_sound.wav");
+    SDL_AudioSpec want = {
+        .freq = AUDIO_SAMPLE_RATE,
+        .format = AUDIO_S16SYS,
+        .channels = 1,
+        .samples = AUDIO_BUFFER_SAMPLES,
+        .callback = audiopl_fill,
+        .userdata = audiopl,
+    };
+    SDL_AudioSpec have;
 
-    if (audiopl->beep_sound == NULL) {
-        fprintf(stderr, "[FATAL ERROR] Unable to load beep_sound.wav !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
+    // Format and channels as asked, SDL converts if the device differs.
+    audiopl->device = SDL_OpenAudioDevice(NULL, 0, &want, &have, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE);
+
+    if (audiopl->device == 0) {
+        fprintf(stderr, "[ERROR] Unable to open the audio device : %s !\n", SDL_GetError());
+        return false;
     }
 
-    Mix_VolumeChunk(audiopl->beep_sound, MIX_MAX_VOLUME / 2);
+    snd_voice_init(&audiopl->voice, (uint32_t)have.freq);
+    SDL_PauseAudioDevice(audiopl->device, 0);
+    return true;
 }
 
 void audiopl_deinit(AudioPlayer* audiopl) {
-    Mix_FreeChunk(audiopl->beep_sound);
+    if (audiopl->device == 0) return;
+    SDL_CloseAudioDevice(audiopl->device);
+    audiopl->device = 0;
 }
 
-void audiopl_play_beep_sound(AudioPlayer* audiopl) {
-    int check = Mix_PlayChannel(-1, audiopl->beep_sound, 0);
-    if (check < 0) {
-        fprintf(stderr, "[FATAL ERROR] Unable to play beep_sound.wav !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
-    }
+// Only this thread writes st, reading it here without the lock is fine.
+void audiopl_set_sound(AudioPlayer* audiopl, const SoundState* st) {
+    if (memcmp(&audiopl->st, st, sizeof(SoundState)) == 0) return;
+
+    SDL_LockAudioDevice(audiopl->device);
+    audiopl->st = *st;
+    SDL_UnlockAudioDevice(audiopl->device);
 }
@@ -2,40 +2,48 @@
     Copyright (c) 2026 - Yann BOYER
 */
 #include "cpu.h"
-#include "audio.h"
 #include "consts.h"
+#include "decoder.h"
 #include "render_engine.h"
 #include <stddef.h>
 #include <stdlib.h>
-#include <time.h>
-#define STB_DS_IMPLEMENTATION
-#include "stb_ds.h"
+#include <string.h>
+
+// Handlers get inlined into every core so their quirk checks fold away.
+#if defined(__GNUC__) || defined(__clang__)
+#define CPU_HANDLER static inline __attribute__((always_inline))
+#else
+#define CPU_HANDLER static inline
+#endif
 
 void cpu_init(CPU* cpu) {
-    // Since KEYS_COUNT has the same value as
-    // REGS_COUNT, only one for loop !
-    for (size_t i = 0; i < REGS_COUNT; i++) {
-        cpu->v_regs[i] = 0;
-        cpu->keys[i] = KEY_NOT_PRESSED;
-    }
+    // Padding included, so two equal machines are equal byte for byte.
+    memset(cpu, 0, sizeof(CPU));
 
-    cpu->stack = NULL;
-    cpu->delay_tm = 0;
-    cpu->sound_tm = 0;
     cpu->pc = CPU_INTERNAL_PROGRAM_COUNTER_START;
+    cpu->key_wait = KEY_WAIT_NONE;
+    cpu->trap = CPU_TRAP_NONE;
+    cpu->quirks = QUIRKS_DEFAULT;
+    cpu_seed_rng(cpu, CPU_DEFAULT_RNG_SEED);
+    memset(cpu->audio_pattern, SOUND_DEFAULT_PATTERN_BYTE, sizeof(cpu->audio_pattern));
+    cpu->audio_pitch = SOUND_DEFAULT_PITCH;
 }
 
-void cpu_deinit(CPU* cpu) {
-    arrfree(cpu->stack);
+// Seeds go through a splitmix64 round, close seeds then give unrelated
+// sequences and none of them the all zero state xorshift can't leave.
+void cpu_seed_rng(CPU* cpu, uint64_t seed) {
+    uint64_t z = seed + 0x9E3779B97F4A7C15ULL;
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    z ^= z >> 31;
+    cpu->rng_state = z != 0 ? z : 0x9E3779B97F4A7C15ULL;
 }
 
-void cpu_update_timers(CPU* cpu, AudioPlayer* audiopl) {
-    if (cpu->delay_tm > 0) cpu->delay_tm--;
-    if (cpu->sound_tm > 0) {
-        cpu->sound_tm--;
+bool cpu_tick_timers(CPU* cpu, uint64_t ticks) {
+    uint8_t sound_before = cpu_sound_timer(cpu);
+    cpu->timer_ticks += ticks;
 
-        if (cpu->sound_tm == 1) audiopl_play_beep_sound(audiopl);
-    }
+    return ticks > 0 && sound_before >= 2 && sound_before - 1 <= ticks;
 }
 
 uint16_t cpu_fetch_next_op(CPU* cpu, Memory* mem) {
@@ -45,272 +53,619 @@ uint16_t cpu_fetch_next_op(CPU* cpu, Memory* mem) {
     return msb << 8 | lsb;
 }
 
-void cpu_decode_and_execute(CPU* cpu, Memory* mem, RenderEngine* re) {
-    uint16_t f_op = cpu_fetch_next_op(cpu, mem);
-
-    // NOTE : Performance penalty of recomputing these
-    // every cycle doesn't seem to be high, but might still
-    // be worth looking at it in the future if I feel the need
-    // to.
-    uint16_t nnn = f_op & 0x0FFF;
-    uint8_t nn = f_op & 0x00FF;
-    uint8_t n = f_op & 0x000F;
-    uint8_t x = (f_op & 0x0F00) >> 8;
-    uint8_t y = (f_op & 0x00F0) >> 4;
-
-    switch (f_op & 0xF000) {
-        case 0x0000:
-            switch (f_op & 0x00FF) {
-                case 0x00E0:
-                    // CLS
-                    re_clear(re);
-                    cpu->pc += 2;
-                    break;
-                case 0x00EE:
-                    // RET
-                    cpu->pc = arrpop(cpu->stack);
-                    cpu->pc += 2;
-                    break;
-                default:
-                    fprintf(stderr, "[FATAL ERROR] Unknown opcode -> 0x%04x\n", f_op);
-                    exit(EXIT_FAILURE); // Ugly, don't care.
-                    break;
-            }
-            break;
-        case 0x1000:
-            // JP addr
-            cpu->pc = nnn;
-            break;
-        case 0x2000:
-            arrpush(cpu->stack, cpu->pc);
-            cpu->pc = nnn;
-            break;
-        case 0x3000:
-            // SE Vx, byte
-            cpu->pc += cpu->v_regs[x] == nn ? 4 : 2;
-            break;
-        case 0x4000:
-            // SNE Vx, byte
-            cpu->pc += cpu->v_regs[x] != nn ? 4 : 2;
-            break;
-        case 0x5000:
-            // SE Vx, Vy
-            cpu->pc += cpu->v_regs[x] == cpu->v_regs[y] ? 4 : 2;
-            break;
-        case 0x6000:
-            // LD Vx, byte
-            cpu->v_regs[x] = nn;
-            cpu->pc += 2;
-            break;
-        case 0x7000:
-            // ADD Vx, byte
-            cpu->v_regs[x] += nn;
-            cpu->pc += 2;
-            break;
-        case 0x8000:
-            switch (f_op & 0x000F) {
-                case 0x0000:
-                    // LD Vx, Vy
-                    cpu->v_regs[x] = cpu->v_regs[y];
-                    cpu->pc += 2;
-                    break;
-                case 0x0001:
-                    // OR Vx, Vy
-                    cpu->v_regs[x] |= cpu->v_regs[y];
-                    cpu->pc += 2;
-                    break;
-                case 0x0002:
-                    // AND Vx, Vy
-                    cpu->v_regs[x] &= cpu->v_regs[y];
-                    cpu->pc += 2;
-                    break;
-                case 0x0003:
-                    // XOR Vx, Vy
-                    cpu->v_regs[x] ^= cpu->v_regs[y];
-                    cpu->pc += 2;
-                    break;
-                case 0x0004:
-                    // ADD Vx, Vy
-                    {
-                        uint16_t r = cpu->v_regs[x] + cpu->v_regs[y];
-
-                        cpu->v_regs[0xF] = r > 0xFF ? 1 : 0;
-
-                        cpu->v_regs[x] = (uint8_t)(r & 0xFF);
-
-                        cpu->pc += 2;
-                    }
-                    break;
-                case 0x0005:
-                    // SUB Vx, Vy
-                    cpu->v_regs[0xF] = cpu->v_regs[x] > cpu->v_regs[y] ? 1 : 0;
-                    cpu->v_regs[x] -= cpu->v_regs[y];
-                    cpu->pc += 2;
-                    break;
-                case 0x0006:
-                    // SHR Vx {, Vy}
-                    cpu->v_regs[0xF] = cpu->v_regs[x] & 0x1;
-                    cpu->v_regs[x] >>= 1;
-                    cpu->pc += 2;
-                    break;
-                case 0x0007:
-                    // SUBN Vx, Vy
-                    cpu->v_regs[0xF] = cpu->v_regs[y] > cpu->v_regs[x] ? 1 : 0;
-                    cpu->v_regs[x] = cpu->v_regs[y] - cpu->v_regs[x];
-                    cpu->pc += 2;
-                    break;
-                case 0x000E:
-                    // SHL Vx [, Vy]
-                    cpu->v_regs[0xF] = (cpu->v_regs[x] & 128) >> 7;
-                    cpu->v_regs[x] <<= 1;
-                    cpu->pc += 2;
-                    break;
-                default:
-                    fprintf(stderr, "[FATAL ERROR] Unknown opcode -> 0x%04x\n", f_op);
-                    exit(EXIT_FAILURE); // Ugly, don't care.
-                    break;
-            }
-            break;
-        case 0x9000:
-            // SNE Vx, Vy
-            cpu->pc += cpu->v_regs[x] != cpu->v_regs[y] ? 4 : 2;
-            break;
-        case 0xA000:
-            // LD I, addr
-            cpu->index_reg = nnn;
-            cpu->pc += 2;
-            break;
-        case 0xB000:
-            // JP V0, addr
-            cpu->pc = nnn + cpu->v_regs[0x0];
-            break;
-        case 0xC000:
-            // RND Vx, byte
-            {
-                srand(time(NULL));
-                uint8_t min = 0;
-                uint8_t max = 255;
-                uint8_t rand_num = rand() % (max - min + 1);
-
-                cpu->v_regs[x] = rand_num & nn;
-                cpu->pc += 2;
-            }
-            break;
-        case 0xD000:
-            // DRW Vx, Vy, nibble
-            {
-                uint8_t x_orig = cpu->v_regs[x];
-                uint8_t y_orig = cpu->v_regs[y];
-
-                cpu->v_regs[0xF] = 0;
-                for (uint8_t y_coord = 0; y_coord < n; y_coord++) {
-                    uint8_t pixel = mem_read(mem, y_coord + cpu->index_reg);
-                    for (uint8_t x_coord = 0; x_coord < 8; x_coord++) {
-                        if ((pixel & (0x80 >> x_coord)) != 0) {
-                            uint8_t x_pixel = (x_orig + x_coord) % CHIP8_SCREEN_WIDTH;
-                            uint8_t y_pixel = (y_orig + y_coord) % CHIP8_SCREEN_HEIGHT;
-
-
-                            // XOR technique, ON -> OFF & Collision, OFF -> ON.
-                            if (re_is_pixel_on(re, x_pixel, y_pixel)) {
-                                re_change_pixel_state_to(re, x_pixel, y_pixel, PIXEL_OFF);
-                                cpu->v_regs[0xF] = 1; // Collision.
-                            } else {
-                                re_change_pixel_state_to(re, x_pixel, y_pixel, PIXEL_ON);
-                            }
-                        }
-                    }
-                }
-
-                cpu->pc += 2;
-            }
-            break;
-        case 0xE000:
-            switch (f_op & 0x00FF) {
-                case 0x009E:
-                    // SKP Vx
-                    cpu->pc += cpu->keys[cpu->v_regs[x]] == KEY_PRESSED ? 4 : 2;
-                    break;
-                case 0x00A1:
-                    // SKNP Vx
-                    cpu->pc += cpu->keys[cpu->v_regs[x]] == KEY_NOT_PRESSED ? 4 : 2;
-                    break;
-                default:
-                    fprintf(stderr, "[FATAL ERROR] Unknown opcode -> 0x%04x\n", f_op);
-                    exit(EXIT_FAILURE); // Ugly, don't care.
-                    break;
-            }
-            break;
-        case 0xF000:
-            switch (f_op & 0x00FF) {
-                case 0x0007:
-                    // LD Vx, DT
-                    cpu->v_regs[x] = cpu->delay_tm;
-                    cpu->pc += 2;
-                    break;
-                case 0x000A:
-                    // LD Vx, K
-                    fprintf(stderr, "[FATAL ERROR] LD Vx, K not implemented !\n");
-                    exit(EXIT_FAILURE);
-                    break;
-                case 0x0015:
-                    // LD DT, Vx
-                    cpu->delay_tm = cpu->v_regs[x];
-                    cpu->pc += 2;
-                    break;
-                case 0x0018:
-                    // LD ST, Vx
-                    cpu->sound_tm = cpu->v_regs[x];
-                    cpu->pc += 2;
-                    break;
-                case 0x001E:
-                    // ADD I, Vx
-                    cpu->index_reg += cpu->v_regs[x];
-                    cpu->pc += 2;
-                    break;
-                case 0x0029:
-                    // LD F, Vx
-                    cpu->index_reg = cpu->v_regs[x] * 5;
-                    cpu->pc += 2;
-                    break;
-                case 0x0033:
-                    // LD B, Vx
-                    {
-                        uint8_t reg_val = cpu->v_regs[x];
-
-                        mem_write(mem, cpu->index_reg, reg_val / 100); // Hundreds.
-                        mem_write(mem, cpu->index_reg + 1, (reg_val % 100) / 10); // Tens.
-                        mem_write(mem, cpu->index_reg + 2, reg_val % 10); // Units.
-
-                        cpu->pc += 2;
-                    }
-                    break;
-                case 0x0055:
-                    // LD [I], Vx
-                    for (uint8_t i = 0; i < x + 1; i++) {
-                        mem_write(mem, cpu->index_reg + i, cpu->v_regs[i]);
-                    }
-
-                    cpu->pc += 2;
-                    break;
-                case 0x0065:
-                    // LD Vx, [I]
-                    for (uint8_t i = 0; i < x + 1; i++) {
-                        cpu->v_regs[i] = mem_read(mem, cpu->index_reg + i);
-                    }
-
-                    cpu->pc += 2;
-                    break;
-                default:
-                    fprintf(stderr, "[FATAL ERROR] Unknown opcode -> 0x%04x\n", f_op);
-                    exit(EXIT_FAILURE); // Ugly, don't care.
-                    break;
-            }
-            break;
-        default:
-            fprintf(stderr, "[FATAL ERROR] Unknown opcode -> 0x%04x\n", f_op);
-            exit(EXIT_FAILURE); // Ugly, don't care.
+const char* cpu_trap_name(CpuTrap trap) {
+    switch (trap) {
+        case CPU_TRAP_NONE: return "none";
+        case CPU_TRAP_INVALID_OPCODE: return "invalid opcode";
+        case CPU_TRAP_OUT_OF_RANGE: return "out of range access";
+        case CPU_TRAP_STACK_UNDERFLOW: return "stack underflow";
+        case CPU_TRAP_STACK_OVERFLOW: return "stack overflow";
+        case CPU_TRAP_UNIMPLEMENTED_OPCODE: return "unimplemented opcode";
+        default: return "unknown trap";
+    }
+}
+
+// Parks the PC on CPU_PARKED_PC, its fetch takes the slow path which hands
+// out the OP_TRAP sentinel, so the cores never test for traps nor halts.
+static inline void cpu_park(CPU* cpu) {
+    cpu->parked_pc = cpu->pc;
+    cpu->pc = CPU_PARKED_PC;
+}
+
+// Handlers return right after raising one, leaving the machine state untouched.
+static inline void cpu_raise_trap(CPU* cpu, CpuTrap trap) {
+    cpu->trap = trap;
+    cpu_park(cpu);
+}
+
+static const DecodedOp CPU_TRAP_OP = { .handler = OP_TRAP };
+
+void cpu_begin_step(CPU* cpu) {
+    cpu->trap = CPU_TRAP_NONE;
+}
+
+CpuTrap cpu_end_step(CPU* cpu) {
+    if (cpu->pc == CPU_PARKED_PC) cpu->pc = cpu->parked_pc;
+    return cpu->trap;
+}
+
+void cpu_set_key(CPU* cpu, uint8_t key, bool pressed) {
+    if (key >= KEYS_COUNT) return;
+    cpu->keys = (uint16_t)((cpu->keys & ~(1u << key)) | (uint32_t)pressed << key);
+
+    if (cpu->key_wait == KEY_WAIT_PRESS && pressed) {
+        cpu->key_wait = KEY_WAIT_RELEASE;
+        cpu->key_wait_key = key;
+    } else if (cpu->key_wait == KEY_WAIT_RELEASE && !pressed && key == cpu->key_wait_key) {
+        // PC is still on the Fx0A, see cpu_end_step().
+        cpu->v_regs[cpu->key_wait_reg] = key;
+        cpu->key_wait = KEY_WAIT_NONE;
+        cpu->pc += 2;
+    }
+}
+
+// Turns a freshly decoded slot into a superinstruction when it starts
+// a known idiom. The fused handlers read their tail operands from the
+// two following slots, so those get their operands refreshed but keep
+// their handler, they still get their own fusion check when reached.
+static void cpu_fuse_slot(Memory* mem, uint16_t addr) {
+    if (addr > TOTAL_MEMORY_SIZE - 2 * FUSED_MAX_OPS) return;
+
+    DecodedOp* slot = &mem->decoded_ops[addr >> 1];
+    DecodedOp next[FUSED_MAX_OPS - 1];
+
+    for (uint8_t i = 0; i < FUSED_MAX_OPS - 1; i++) {
+        uint16_t next_addr = addr + 2 * (i + 1);
+        next[i] = decoder_decode_op(mem->mem[next_addr] << 8 | mem->mem[next_addr + 1]);
+
+        uint8_t handler = slot[i + 1].handler;
+        slot[i + 1] = next[i];
+        slot[i + 1].handler = handler;
+    }
+
+    slot->handler = decoder_fuse_ops(slot, &next[0], &next[1], addr);
+}
+
+const DecodedOp* cpu_fetch_decoded_op(CPU* cpu, Memory* mem, DecodedOp* scratch) {
+    // Odd or last-byte PCs have no slot, decode them on the spot.
+    if ((cpu->pc & 0x1) != 0 || cpu->pc > TOTAL_MEMORY_SIZE - 2) {
+        // CPU_PARKED_PC lands here too.
+        if (cpu->pc > TOTAL_MEMORY_SIZE - 2) {
+            if (cpu->trap == CPU_TRAP_NONE && cpu->key_wait == KEY_WAIT_NONE) cpu_raise_trap(cpu, CPU_TRAP_OUT_OF_RANGE);
+            return &CPU_TRAP_OP;
+        }
+
+        *scratch = decoder_decode_op(cpu_fetch_next_op(cpu, mem));
+        return scratch;
+    }
+
+    DecodedOp* slot = &mem->decoded_ops[cpu->pc >> 1];
+    if (slot->handler == OP_UNDECODED) {
+        *slot = decoder_decode_op(cpu_fetch_next_op(cpu, mem));
+        cpu_fuse_slot(mem, cpu->pc);
+    }
+
+    return slot;
+}
+
+// Instruction handlers, shared by the switch and the threaded cores
+// so both always produce the exact same machine state.
+
+CPU_HANDLER void cpu_op_cls(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    re_clear(re);
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ret(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (cpu->sp == 0) {
+        cpu_raise_trap(cpu, CPU_TRAP_STACK_UNDERFLOW);
+        return;
+    }
+
+    cpu->pc = cpu->stack[--cpu->sp];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_jp_addr(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc = d_op->nnn;
+}
+
+CPU_HANDLER void cpu_op_call_addr(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (cpu->sp >= CPU_STACK_DEPTH) {
+        cpu_raise_trap(cpu, CPU_TRAP_STACK_OVERFLOW);
+        return;
+    }
+
+    cpu->stack[cpu->sp++] = cpu->pc;
+    cpu->pc = d_op->nnn;
+}
+
+CPU_HANDLER void cpu_op_se_vx_byte(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc += cpu->v_regs[d_op->x] == d_op->nn ? 4 : 2;
+}
+
+CPU_HANDLER void cpu_op_sne_vx_byte(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc += cpu->v_regs[d_op->x] != d_op->nn ? 4 : 2;
+}
+
+CPU_HANDLER void cpu_op_se_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc += cpu->v_regs[d_op->x] == cpu->v_regs[d_op->y] ? 4 : 2;
+}
+
+CPU_HANDLER void cpu_op_ld_vx_byte(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] = d_op->nn;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_add_vx_byte(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] += d_op->nn;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] = cpu->v_regs[d_op->y];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_or_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] |= cpu->v_regs[d_op->y];
+    if (q.vf_reset) cpu->v_regs[0xF] = 0;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_and_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] &= cpu->v_regs[d_op->y];
+    if (q.vf_reset) cpu->v_regs[0xF] = 0;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_xor_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] ^= cpu->v_regs[d_op->y];
+    if (q.vf_reset) cpu->v_regs[0xF] = 0;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_add_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    uint16_t r = cpu->v_regs[d_op->x] + cpu->v_regs[d_op->y];
+
+    cpu->v_regs[0xF] = r > 0xFF ? 1 : 0;
+
+    cpu->v_regs[d_op->x] = (uint8_t)(r & 0xFF);
+
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_sub_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[0xF] = cpu->v_regs[d_op->x] > cpu->v_regs[d_op->y] ? 1 : 0;
+    cpu->v_regs[d_op->x] -= cpu->v_regs[d_op->y];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_shr_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (q.shift_vy) {
+        uint8_t src = cpu->v_regs[d_op->y];
+        cpu->v_regs[0xF] = src & 0x1;
+        cpu->v_regs[d_op->x] = src >> 1;
+    } else {
+        cpu->v_regs[0xF] = cpu->v_regs[d_op->x] & 0x1;
+        cpu->v_regs[d_op->x] >>= 1;
+    }
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_subn_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[0xF] = cpu->v_regs[d_op->y] > cpu->v_regs[d_op->x] ? 1 : 0;
+    cpu->v_regs[d_op->x] = cpu->v_regs[d_op->y] - cpu->v_regs[d_op->x];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_shl_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (q.shift_vy) {
+        uint8_t src = cpu->v_regs[d_op->y];
+        cpu->v_regs[0xF] = (src & 128) >> 7;
+        cpu->v_regs[d_op->x] = src << 1;
+    } else {
+        cpu->v_regs[0xF] = (cpu->v_regs[d_op->x] & 128) >> 7;
+        cpu->v_regs[d_op->x] <<= 1;
+    }
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_sne_vx_vy(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc += cpu->v_regs[d_op->x] != cpu->v_regs[d_op->y] ? 4 : 2;
+}
+
+CPU_HANDLER void cpu_op_ld_i_addr(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->index_reg = d_op->nnn;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_jp_v0_addr(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc = d_op->nnn + cpu->v_regs[0x0];
+}
+
+CPU_HANDLER void cpu_op_rnd_vx_byte(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] = cpu_next_random(cpu) & d_op->nn;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_drw_vx_vy_n(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    uint8_t x_orig = cpu->v_regs[d_op->x];
+    uint8_t y_orig = cpu->v_regs[d_op->y];
+    uint8_t n = d_op->nn & 0x0F;
+
+    if (q.clip_sprites) {
+        // Only the origin wraps, rows past the bottom edge get clipped.
+        x_orig %= CHIP8_SCREEN_WIDTH;
+        y_orig %= CHIP8_SCREEN_HEIGHT;
+        if (y_orig + n > CHIP8_SCREEN_HEIGHT) n = CHIP8_SCREEN_HEIGHT - y_orig;
+    }
+
+    if (cpu->index_reg + n > TOTAL_MEMORY_SIZE) {
+        cpu_raise_trap(cpu, CPU_TRAP_OUT_OF_RANGE);
+        return;
+    }
+
+    // One masked XOR per sprite row, collision is any bit it turned off.
+    bool collision = false;
+    for (uint8_t y_coord = 0; y_coord < n; y_coord++) {
+        uint8_t sprite_byte = mem->mem[cpu->index_reg + y_coord];
+        uint64_t mask = re_sprite_row_mask(sprite_byte, x_orig, q.clip_sprites);
+        collision |= re_xor_row(re, (y_orig + y_coord) % CHIP8_SCREEN_HEIGHT, mask);
+    }
+
+    cpu->v_regs[0xF] = collision;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_skp_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    // Only the low nibble names a key.
+    cpu->pc += (cpu->keys >> (cpu->v_regs[d_op->x] & 0xF) & 1) != 0 ? 4 : 2;
+}
+
+CPU_HANDLER void cpu_op_sknp_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->pc += (cpu->keys >> (cpu->v_regs[d_op->x] & 0xF) & 1) == 0 ? 4 : 2;
+}
+
+CPU_HANDLER void cpu_op_ld_vx_dt(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->v_regs[d_op->x] = cpu_delay_timer(cpu);
+    cpu->pc += 2;
+}
+
+// Halts until cpu_set_key() sees a key go down then up, a key already
+// held counts as pressed. The rest of the step never runs.
+CPU_HANDLER void cpu_op_ld_vx_k(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->key_wait = KEY_WAIT_PRESS;
+    cpu->key_wait_reg = d_op->x;
+
+    for (uint8_t key = 0; key < KEYS_COUNT; key++) {
+        if ((cpu->keys >> key & 1) != 0) {
+            cpu->key_wait = KEY_WAIT_RELEASE;
+            cpu->key_wait_key = key;
             break;
+        }
+    }
+
+    cpu_park(cpu);
+}
 
+CPU_HANDLER void cpu_op_ld_dt_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->delay_expiry = cpu->timer_ticks + cpu->v_regs[d_op->x];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_st_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->sound_expiry = cpu->timer_ticks + cpu->v_regs[d_op->x];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_add_i_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->index_reg += cpu->v_regs[d_op->x];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_f_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->index_reg = cpu->v_regs[d_op->x] * 5;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_b_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    uint8_t reg_val = cpu->v_regs[d_op->x];
+
+    if (cpu->index_reg + 3 > TOTAL_MEMORY_SIZE) {
+        cpu_raise_trap(cpu, CPU_TRAP_OUT_OF_RANGE);
+        return;
+    }
+
+    // mem_write() invalidates the slots we land in.
+    mem_write(mem, cpu->index_reg, reg_val / 100); // Hundreds.
+    mem_write(mem, cpu->index_reg + 1, (reg_val % 100) / 10); // Tens.
+    mem_write(mem, cpu->index_reg + 2, reg_val % 10); // Units.
+
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_mem_i_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (cpu->index_reg + d_op->x + 1 > TOTAL_MEMORY_SIZE) {
+        cpu_raise_trap(cpu, CPU_TRAP_OUT_OF_RANGE);
+        return;
+    }
+
+    // Same as above, slots get invalidated by mem_write().
+    for (uint8_t i = 0; i < d_op->x + 1; i++) {
+        mem_write(mem, cpu->index_reg + i, cpu->v_regs[i]);
+    }
+
+    if (q.load_store_inc_i) cpu->index_reg += d_op->x + 1;
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_vx_mem_i(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (cpu->index_reg + d_op->x + 1 > TOTAL_MEMORY_SIZE) {
+        cpu_raise_trap(cpu, CPU_TRAP_OUT_OF_RANGE);
+        return;
+    }
+
+    for (uint8_t i = 0; i < d_op->x + 1; i++) {
+        cpu->v_regs[i] = mem->mem[cpu->index_reg + i];
     }
+
+    if (q.load_store_inc_i) cpu->index_reg += d_op->x + 1;
+    cpu->pc += 2;
+}
+
+// XO-CHIP, 16 bytes at I become the sound pattern, I doesn't move.
+CPU_HANDLER void cpu_op_ld_audio_i(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    if (cpu->index_reg + SOUND_PATTERN_BYTES > TOTAL_MEMORY_SIZE) {
+        cpu_raise_trap(cpu, CPU_TRAP_OUT_OF_RANGE);
+        return;
+    }
+
+    memcpy(cpu->audio_pattern, &mem->mem[cpu->index_reg], SOUND_PATTERN_BYTES);
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_ld_pitch_vx(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu->audio_pitch = cpu->v_regs[d_op->x];
+    cpu->pc += 2;
+}
+
+CPU_HANDLER void cpu_op_unknown(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu_raise_trap(cpu, CPU_TRAP_INVALID_OPCODE);
+}
+
+// Superinstructions, same effects as running their parts one by one
+// (VF and timers included). They return how many instructions retired.
+
+CPU_HANDLER uint8_t cpu_fused_ld_ldi_drw(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu_op_ld_vx_byte(cpu, mem, re, d_op, q);
+    cpu_op_ld_i_addr(cpu, mem, re, d_op + 1, q);
+    cpu_op_drw_vx_vy_n(cpu, mem, re, d_op + 2, q);
+    return 3;
+}
+
+CPU_HANDLER uint8_t cpu_fused_dt_wait(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu_op_ld_vx_dt(cpu, mem, re, d_op, q);
+    cpu_op_se_vx_byte(cpu, mem, re, d_op + 1, q);
+    if (cpu->v_regs[d_op->x] == d_op[1].nn) return 2; // JP got skipped.
+
+    cpu_op_jp_addr(cpu, mem, re, d_op + 2, q);
+    return 3;
+}
+
+CPU_HANDLER uint8_t cpu_fused_add_se_jp(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu_op_add_vx_byte(cpu, mem, re, d_op, q);
+    cpu_op_se_vx_byte(cpu, mem, re, d_op + 1, q);
+    if (cpu->v_regs[d_op->x] == d_op[1].nn) return 2; // JP got skipped.
+
+    cpu_op_jp_addr(cpu, mem, re, d_op + 2, q);
+    return 3;
+}
+
+CPU_HANDLER uint8_t cpu_fused_addi_drw(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    cpu_op_add_i_vx(cpu, mem, re, d_op, q);
+    cpu_op_drw_vx_vy_n(cpu, mem, re, d_op + 1, q);
+    return 2;
+}
+
+CPU_HANDLER uint8_t cpu_execute_fused(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    switch (d_op->handler) {
+        case OP_FUSED_LD_LDI_DRW: return cpu_fused_ld_ldi_drw(cpu, mem, re, d_op, q);
+        case OP_FUSED_DT_WAIT: return cpu_fused_dt_wait(cpu, mem, re, d_op, q);
+        case OP_FUSED_ADD_SE_JP: return cpu_fused_add_se_jp(cpu, mem, re, d_op, q);
+        default: return cpu_fused_addi_drw(cpu, mem, re, d_op, q);
+    }
+}
+
+// Runs an idle loop for what's left of the budget (`cycles` counting
+// this op), returns how many instructions retired. Until the next timer
+// tick every iteration leaves the same state, so the PC just lands
+// where running them one by one would have left it.
+CPU_HANDLER uint32_t cpu_run_idle_loop(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, uint32_t cycles) {
+    uint32_t retired = cycles;
+
+    if (d_op->handler == OP_IDLE_DT_WAIT) {
+        uint16_t loop_pc = cpu->pc;
+        uint8_t delay_tm = cpu_delay_timer(cpu);
+        cpu->v_regs[d_op->x] = delay_tm;
+
+        if (delay_tm == d_op[1].nn) {
+            // Leaves right away, the SE skips the JP.
+            retired = cycles < 2 ? cycles : 2;
+            cpu->pc += retired == 2 ? 6 : 2;
+            return retired;
+        }
+
+        cpu->pc = loop_pc + 2 * (cycles % 3);
+    }
+
+    cpu->idle_ops += retired;
+    return retired;
+}
+
+static inline bool cpu_fused_op_draws(uint8_t handler) {
+    return handler == OP_FUSED_LD_LDI_DRW || handler == OP_FUSED_ADDI_DRW;
+}
+
+CPU_HANDLER void cpu_execute_quirks(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op, const QuirkProfile q) {
+    switch (d_op->handler) {
+        case OP_CLS: cpu_op_cls(cpu, mem, re, d_op, q); break;
+        case OP_RET: cpu_op_ret(cpu, mem, re, d_op, q); break;
+        case OP_JP_ADDR: cpu_op_jp_addr(cpu, mem, re, d_op, q); break;
+        case OP_CALL_ADDR: cpu_op_call_addr(cpu, mem, re, d_op, q); break;
+        case OP_SE_VX_BYTE: cpu_op_se_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_SNE_VX_BYTE: cpu_op_sne_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_SE_VX_VY: cpu_op_se_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_LD_VX_BYTE: cpu_op_ld_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_ADD_VX_BYTE: cpu_op_add_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_LD_VX_VY: cpu_op_ld_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_OR_VX_VY: cpu_op_or_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_AND_VX_VY: cpu_op_and_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_XOR_VX_VY: cpu_op_xor_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_ADD_VX_VY: cpu_op_add_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_SUB_VX_VY: cpu_op_sub_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_SHR_VX: cpu_op_shr_vx(cpu, mem, re, d_op, q); break;
+        case OP_SUBN_VX_VY: cpu_op_subn_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_SHL_VX: cpu_op_shl_vx(cpu, mem, re, d_op, q); break;
+        case OP_SNE_VX_VY: cpu_op_sne_vx_vy(cpu, mem, re, d_op, q); break;
+        case OP_LD_I_ADDR: cpu_op_ld_i_addr(cpu, mem, re, d_op, q); break;
+        case OP_JP_V0_ADDR: cpu_op_jp_v0_addr(cpu, mem, re, d_op, q); break;
+        case OP_RND_VX_BYTE: cpu_op_rnd_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_DRW_VX_VY_N: cpu_op_drw_vx_vy_n(cpu, mem, re, d_op, q); break;
+        case OP_SKP_VX: cpu_op_skp_vx(cpu, mem, re, d_op, q); break;
+        case OP_SKNP_VX: cpu_op_sknp_vx(cpu, mem, re, d_op, q); break;
+        case OP_LD_VX_DT: cpu_op_ld_vx_dt(cpu, mem, re, d_op, q); break;
+        case OP_LD_VX_K: cpu_op_ld_vx_k(cpu, mem, re, d_op, q); break;
+        case OP_LD_DT_VX: cpu_op_ld_dt_vx(cpu, mem, re, d_op, q); break;
+        case OP_LD_ST_VX: cpu_op_ld_st_vx(cpu, mem, re, d_op, q); break;
+        case OP_ADD_I_VX: cpu_op_add_i_vx(cpu, mem, re, d_op, q); break;
+        case OP_LD_F_VX: cpu_op_ld_f_vx(cpu, mem, re, d_op, q); break;
+        case OP_LD_B_VX: cpu_op_ld_b_vx(cpu, mem, re, d_op, q); break;
+        case OP_LD_MEM_I_VX: cpu_op_ld_mem_i_vx(cpu, mem, re, d_op, q); break;
+        case OP_LD_VX_MEM_I: cpu_op_ld_vx_mem_i(cpu, mem, re, d_op, q); break;
+        case OP_LD_AUDIO_I: cpu_op_ld_audio_i(cpu, mem, re, d_op, q); break;
+        case OP_LD_PITCH_VX: cpu_op_ld_pitch_vx(cpu, mem, re, d_op, q); break;
+        // Single stepping a fused slot only runs its first part.
+        case OP_FUSED_LD_LDI_DRW: cpu_op_ld_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_FUSED_DT_WAIT: cpu_op_ld_vx_dt(cpu, mem, re, d_op, q); break;
+        case OP_FUSED_ADD_SE_JP: cpu_op_add_vx_byte(cpu, mem, re, d_op, q); break;
+        case OP_FUSED_ADDI_DRW: cpu_op_add_i_vx(cpu, mem, re, d_op, q); break;
+        case OP_IDLE_DT_WAIT: cpu_op_ld_vx_dt(cpu, mem, re, d_op, q); break;
+        case OP_IDLE_JP_SELF: cpu_op_jp_addr(cpu, mem, re, d_op, q); break;
+        case OP_TRAP: break; // Nothing to run, the PC is already parked.
+        default: cpu_op_unknown(cpu, mem, re, d_op, q); break;
+    }
+}
+
+// Translated code (JIT/AOT) only exists for the default quirks,
+// so do their interpreter fallbacks.
+void cpu_execute(CPU* cpu, Memory* mem, RenderEngine* re, const DecodedOp* d_op) {
+    cpu_execute_quirks(cpu, mem, re, d_op, QUIRKS_DEFAULT);
+}
+
+void cpu_decode_and_execute(CPU* cpu, Memory* mem, RenderEngine* re) {
+    DecodedOp scratch;
+    cpu_execute(cpu, mem, re, cpu_fetch_decoded_op(cpu, mem, &scratch));
+}
+
+// Takes the slot at cpu->pc the way the default quirks core would : an idle
+// loop elides up to the budget, a fused op runs whole when the budget allows.
+uint32_t cpu_run_fallback(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles) {
+    DecodedOp scratch;
+    const DecodedOp* d_op = cpu_fetch_decoded_op(cpu, mem, &scratch);
+
+    if (d_op->handler >= OP_IDLE_FIRST && d_op->handler != OP_TRAP) return cpu_run_idle_loop(cpu, mem, re, d_op, cycles);
+
+    if (d_op->handler >= OP_FUSED_FIRST && d_op->handler < OP_IDLE_FIRST && cycles >= FUSED_MAX_OPS) {
+        uint8_t retired = cpu_execute_fused(cpu, mem, re, d_op, QUIRKS_DEFAULT);
+        // A trailing DRW that trapped never retired.
+        cpu->fused_ops += retired - (cpu->trap != CPU_TRAP_NONE);
+        return retired;
+    }
+
+    cpu_execute(cpu, mem, re, d_op);
+    return 1;
+}
+
+// One interpreter core per quirk combination, each built from
+// cpu_core_template.h with its quirks as compile-time constants so
+// none of them branches on a quirk.
+#define CPU_CORE_BITS 0
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 1
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 2
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 3
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 4
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 5
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 6
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 7
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 8
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 9
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 10
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 11
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 12
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 13
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 14
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 15
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 16
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 17
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 18
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 19
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 20
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 21
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 22
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 23
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 24
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 25
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 26
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 27
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 28
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 29
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 30
+#include "cpu_core_template.h"
+#define CPU_CORE_BITS 31
+#include "cpu_core_template.h"
+
+static const CpuCoreFn CPU_CORES[QUIRK_COMBINATIONS_COUNT] = {
+    cpu_core_0, cpu_core_1, cpu_core_2, cpu_core_3,
+    cpu_core_4, cpu_core_5, cpu_core_6, cpu_core_7,
+    cpu_core_8, cpu_core_9, cpu_core_10, cpu_core_11,
+    cpu_core_12, cpu_core_13, cpu_core_14, cpu_core_15,
+    cpu_core_16, cpu_core_17, cpu_core_18, cpu_core_19,
+    cpu_core_20, cpu_core_21, cpu_core_22, cpu_core_23,
+    cpu_core_24, cpu_core_25, cpu_core_26, cpu_core_27,
+    cpu_core_28, cpu_core_29, cpu_core_30, cpu_core_31,
+};
+
+CpuCoreFn cpu_select_core(QuirkProfile quirks) {
+    return CPU_CORES[quirks_to_bits(quirks)];
 }
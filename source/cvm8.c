@@ -0,0 +1,137 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "cvm8.h"
+#include "emu.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct Cvm8 {
+    Emulator emu;
+    // What the last cvm8_take_dirty_rows() returned, kept out of the
+    // machine state since taking them is no emulated event.
+    RenderEngine taken;
+    bool has_taken;
+};
+
+Cvm8* cvm8_create(QuirkProfile quirks) {
+    // The machine state is cache line aligned, malloc() only promises 16.
+    Cvm8* vm = (Cvm8*) aligned_alloc(_Alignof(Cvm8), sizeof(Cvm8));
+
+    if (vm == NULL) return NULL;
+
+    emu_init(&vm->emu, quirks);
+    vm->has_taken = false;
+    return vm;
+}
+
+void cvm8_destroy(Cvm8* vm) {
+    emu_deinit(&vm->emu);
+    free(vm);
+}
+
+bool cvm8_load_rom(Cvm8* vm, const uint8_t* rom_buf, size_t rom_size) {
+    return emu_load_rom(&vm->emu, rom_buf, rom_size);
+}
+
+bool cvm8_load_rom_from_file(Cvm8* vm, const char* rom_path) {
+    return emu_load_rom_from_file(&vm->emu, rom_path);
+}
+
+void cvm8_seed_rng(Cvm8* vm, uint64_t seed) {
+    cpu_seed_rng(&vm->emu.state.cpu, seed);
+}
+
+void cvm8_set_ipf(Cvm8* vm, uint32_t ipf) {
+    emu_set_ipf(&vm->emu, ipf);
+}
+
+uint32_t cvm8_get_ipf(const Cvm8* vm) {
+    return vm->emu.state.ipf;
+}
+
+CpuTrap cvm8_step(Cvm8* vm, uint32_t cycles) {
+    return emu_do_cpu_cycles(&vm->emu, cycles);
+}
+
+uint64_t cvm8_get_cycle(const Cvm8* vm) {
+    return vm->emu.state.cycle;
+}
+
+uint16_t cvm8_get_pc(const Cvm8* vm) {
+    return vm->emu.state.cpu.pc;
+}
+
+bool cvm8_is_halted(const Cvm8* vm) {
+    return cpu_is_halted(&vm->emu.state.cpu);
+}
+
+bool cvm8_skip_halted_frames(Cvm8* vm, uint32_t frames) {
+    return emu_skip_halted_frames(&vm->emu, frames);
+}
+
+bool cvm8_is_sound_on(const Cvm8* vm) {
+    return cpu_sound_timer(&vm->emu.state.cpu) > 0;
+}
+
+void cvm8_get_sound(const Cvm8* vm, SoundState* st) {
+    memcpy(st->pattern, vm->emu.state.cpu.audio_pattern, SOUND_PATTERN_BYTES);
+    st->pitch = vm->emu.state.cpu.audio_pitch;
+    st->on = cpu_sound_timer(&vm->emu.state.cpu) > 0;
+}
+
+const RenderEngine* cvm8_framebuffer(const Cvm8* vm) {
+    return &vm->emu.state.re;
+}
+
+// A diff rather than bits set by the draws, still right after a load or
+// a copy replaced the whole screen.
+uint32_t cvm8_take_dirty_rows(Cvm8* vm) {
+    const RenderEngine* re = &vm->emu.state.re;
+    uint32_t dirty_rows = vm->has_taken ? re_diff_rows(&vm->taken, re) : RE_ALL_ROWS_DIRTY;
+
+    vm->taken = *re;
+    vm->has_taken = true;
+    return dirty_rows;
+}
+
+bool cvm8_is_pixel_on(const Cvm8* vm, uint8_t x, uint8_t y) {
+    return re_is_pixel_on(&vm->emu.state.re, x, y);
+}
+
+void cvm8_set_key(Cvm8* vm, uint8_t key, bool pressed) {
+    emu_set_key(&vm->emu, key, pressed);
+}
+
+bool cvm8_queue_key(Cvm8* vm, uint64_t cycle, uint8_t key, bool pressed) {
+    return emu_queue_key(&vm->emu, cycle, key, pressed);
+}
+
+uint32_t cvm8_pending_keys(const Cvm8* vm) {
+    return kevq_count(&vm->emu.state.key_events);
+}
+
+void cvm8_set_beep_callback(Cvm8* vm, Cvm8BeepFn on_beep, void* user_data) {
+    vm->emu.on_beep = on_beep;
+    vm->emu.beep_user_data = user_data;
+}
+
+void cvm8_print_fusion_report(Cvm8* vm, const char* rom_path) {
+    emu_print_fusion_report(&vm->emu, rom_path);
+}
+
+void cvm8_copy_state(Cvm8* dst, const Cvm8* src) {
+    emu_copy_state(&dst->emu, &src->emu);
+}
+
+uint64_t cvm8_hash_state(const Cvm8* vm) {
+    return emu_hash_state(&vm->emu);
+}
+
+bool cvm8_save_state(const Cvm8* vm, const char* path) {
+    return emu_save_state(&vm->emu, path);
+}
+
+bool cvm8_load_state(Cvm8* vm, const char* path) {
+    return emu_load_state(&vm->emu, path);
+}
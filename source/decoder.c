@@ -0,0 +1,104 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "decoder.h"
+
+static OpHandler decoder_find_handler(uint16_t op) {
+    switch (op & 0xF000) {
+        case 0x0000:
+            switch (op & 0x00FF) {
+                case 0x00E0: return OP_CLS;
+                case 0x00EE: return OP_RET;
+                default: return OP_UNKNOWN;
+            }
+        case 0x1000: return OP_JP_ADDR;
+        case 0x2000: return OP_CALL_ADDR;
+        case 0x3000: return OP_SE_VX_BYTE;
+        case 0x4000: return OP_SNE_VX_BYTE;
+        case 0x5000: return OP_SE_VX_VY;
+        case 0x6000: return OP_LD_VX_BYTE;
+        case 0x7000: return OP_ADD_VX_BYTE;
+        case 0x8000:
+            switch (op & 0x000F) {
+                case 0x0000: return OP_LD_VX_VY;
+                case 0x0001: return OP_OR_VX_VY;
+                case 0x0002: return OP_AND_VX_VY;
+                case 0x0003: return OP_XOR_VX_VY;
+                case 0x0004: return OP_ADD_VX_VY;
+                case 0x0005: return OP_SUB_VX_VY;
+                case 0x0006: return OP_SHR_VX;
+                case 0x0007: return OP_SUBN_VX_VY;
+                case 0x000E: return OP_SHL_VX;
+                default: return OP_UNKNOWN;
+            }
+        case 0x9000: return OP_SNE_VX_VY;
+        case 0xA000: return OP_LD_I_ADDR;
+        case 0xB000: return OP_JP_V0_ADDR;
+        case 0xC000: return OP_RND_VX_BYTE;
+        case 0xD000: return OP_DRW_VX_VY_N;
+        case 0xE000:
+            switch (op & 0x00FF) {
+                case 0x009E: return OP_SKP_VX;
+                case 0x00A1: return OP_SKNP_VX;
+                default: return OP_UNKNOWN;
+            }
+        case 0xF000:
+            if (op == 0xF002) return OP_LD_AUDIO_I;
+            switch (op & 0x00FF) {
+                case 0x0007: return OP_LD_VX_DT;
+                case 0x000A: return OP_LD_VX_K;
+                case 0x0015: return OP_LD_DT_VX;
+                case 0x0018: return OP_LD_ST_VX;
+                case 0x001E: return OP_ADD_I_VX;
+                case 0x0029: return OP_LD_F_VX;
+                case 0x0033: return OP_LD_B_VX;
+                case 0x0055: return OP_LD_MEM_I_VX;
+                case 0x0065: return OP_LD_VX_MEM_I;
+                case 0x003A: return OP_LD_PITCH_VX;
+                default: return OP_UNKNOWN;
+            }
+        default: return OP_UNKNOWN;
+    }
+}
+
+DecodedOp decoder_decode_op(uint16_t op) {
+    DecodedOp d_op = {
+        .op = op,
+        .nnn = op & 0x0FFF,
+        .handler = decoder_find_handler(op),
+        .nn = op & 0x00FF,
+        .x = (op & 0x0F00) >> 8,
+        .y = (op & 0x00F0) >> 4,
+    };
+
+    return d_op;
+}
+
+OpHandler decoder_fuse_ops(const DecodedOp* first, const DecodedOp* second, const DecodedOp* third, uint16_t addr) {
+    switch (first->handler) {
+        case OP_JP_ADDR:
+            if (first->nnn == addr) return OP_IDLE_JP_SELF;
+            break;
+        case OP_LD_VX_BYTE:
+            if (second->handler == OP_LD_I_ADDR && third->handler == OP_DRW_VX_VY_N) return OP_FUSED_LD_LDI_DRW;
+            break;
+        case OP_LD_VX_DT:
+            // Delay timer wait loop.
+            if (second->handler == OP_SE_VX_BYTE && second->x == first->x && third->handler == OP_JP_ADDR) {
+                // Nothing in the loop moves the delay timer, back to itself it spins until the next tick.
+                return third->nnn == addr ? OP_IDLE_DT_WAIT : OP_FUSED_DT_WAIT;
+            }
+            break;
+        case OP_ADD_VX_BYTE:
+            // Counter loop.
+            if (second->handler == OP_SE_VX_BYTE && second->x == first->x && third->handler == OP_JP_ADDR) return OP_FUSED_ADD_SE_JP;
+            break;
+        case OP_ADD_I_VX:
+            if (second->handler == OP_DRW_VX_VY_N) return OP_FUSED_ADDI_DRW;
+            break;
+        default:
+            break;
+    }
+
+    return first->handler;
+}
@@ -0,0 +1,140 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "display.h"
+#include "consts.h"
+#include <stdio.h>
+
+bool disp_init(Display* disp, const char* title, ScalerFilter filter, bool persistence) {
+    if (persistence && filter != SCALER_FILTER_NONE) {
+        fprintf(stdout, "[INFO] Filters don't apply to phosphor persistence, ignoring the filter.\n");
+        filter = SCALER_FILTER_NONE;
+    }
+
+    uint8_t factor = scaler_filter_factor(filter);
+
+    disp->window = SDL_CreateWindow(title, SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+
+    if (disp->window == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Unable to create the window !\n");
+        return false;
+    }
+
+    // Keep the pixels sharp when scaling up.
+    SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
+
+    disp->renderer = SDL_CreateRenderer(disp->window, -1, SDL_RENDERER_ACCELERATED);
+
+    if (disp->renderer == NULL) {
+        fprintf(stdout, "[INFO] No accelerated renderer, falling back to software.\n");
+        disp->renderer = SDL_CreateRenderer(disp->window, -1, SDL_RENDERER_SOFTWARE);
+    }
+
+    if (disp->renderer == NULL) {
+        SDL_DestroyWindow(disp->window);
+        fprintf(stderr, "[FATAL ERROR] Unable to create the renderer !\n");
+        return false;
+    }
+
+    disp->texture = SDL_CreateTexture(disp->renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_STREAMING, CHIP8_SCREEN_WIDTH * factor, CHIP8_SCREEN_HEIGHT * factor);
+
+    if (disp->texture == NULL) {
+        SDL_DestroyRenderer(disp->renderer);
+        SDL_DestroyWindow(disp->window);
+        fprintf(stderr, "[FATAL ERROR] Unable to create the screen texture !\n");
+        return false;
+    }
+
+    disp->filter = filter;
+    disp->persistence = persistence;
+    phos_init(&disp->phos, PHOSPHOR_DEFAULT_DECAY);
+
+    // Per channel blend from the off to the on color.
+    for (uint16_t i = 0; i <= PHOSPHOR_FULL_INTENSITY; i++) {
+        uint32_t color = 0;
+        for (uint8_t shift = 0; shift < 32; shift += 8) {
+            uint32_t off = DISPLAY_COLOR_OFF >> shift & 0xFF;
+            uint32_t on = DISPLAY_COLOR_ON >> shift & 0xFF;
+            color |= ((off * (PHOSPHOR_FULL_INTENSITY - i) + on * i) / PHOSPHOR_FULL_INTENSITY) << shift;
+        }
+        disp->palette[i] = color;
+    }
+    disp->needs_present = true;
+    disp->frames_presented = 0;
+    disp->frames_skipped = 0;
+    disp->rows_uploaded = 0;
+
+    return true;
+}
+
+void disp_deinit(Display* disp) {
+    SDL_DestroyTexture(disp->texture);
+    SDL_DestroyRenderer(disp->renderer);
+    SDL_DestroyWindow(disp->window);
+}
+
+// Expands rows [first, last] into the texture with a single lock.
+static void disp_upload_rows(Display* disp, const RenderEngine* re, uint8_t first, uint8_t last) {
+    uint8_t factor = scaler_filter_factor(disp->filter);
+    SDL_Rect area = { 0, first * factor, CHIP8_SCREEN_WIDTH * factor, (last - first + 1) * factor };
+    void* pixels;
+    int pitch;
+
+    if (SDL_LockTexture(disp->texture, &area, &pixels, &pitch) != 0) return;
+
+    if (disp->persistence) {
+        for (uint8_t y = first; y <= last; y++) {
+            uint32_t* line = (uint32_t*)((uint8_t*)pixels + (y - first) * pitch);
+            for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+                line[x] = disp->palette[disp->phos.intensity[y][x]];
+            }
+        }
+    } else {
+        scaler_scale_rows(re, disp->filter, factor, DISPLAY_COLOR_ON, DISPLAY_COLOR_OFF, first, last, pixels, pitch / sizeof(uint32_t));
+    }
+
+    SDL_UnlockTexture(disp->texture);
+    disp->rows_uploaded += last - first + 1;
+}
+
+bool disp_present(Display* disp, const RenderEngine* re, uint32_t dirty_rows) {
+    // Fading rows change even when the framebuffer doesn't, the
+    // first frame fills the whole texture.
+    if (disp->persistence) {
+        dirty_rows = phos_update(&disp->phos, re);
+        if (disp->frames_presented == 0) dirty_rows = RE_ALL_ROWS_DIRTY;
+    }
+
+    if (dirty_rows == 0 && !disp->needs_present) {
+        disp->frames_skipped++;
+        return false;
+    }
+
+    // Filtered rows also depend on the rows around them.
+    if (disp->filter != SCALER_FILTER_NONE) dirty_rows |= dirty_rows << 1 | dirty_rows >> 1;
+
+    // One lock per run of consecutive dirty rows.
+    for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        if ((dirty_rows >> y & 1) == 0) continue;
+
+        uint8_t first = y;
+        while (y + 1 < CHIP8_SCREEN_HEIGHT && (dirty_rows >> (y + 1) & 1) != 0) y++;
+        disp_upload_rows(disp, re, first, y);
+    }
+
+    SDL_RenderClear(disp->renderer);
+    SDL_RenderCopy(disp->renderer, disp->texture, NULL, NULL);
+    SDL_RenderPresent(disp->renderer);
+    disp->needs_present = false;
+    disp->frames_presented++;
+    return true;
+}
+
+void disp_invalidate(Display* disp) {
+    disp->needs_present = true;
+}
+
+void disp_print_stats(Display* disp) {
+    fprintf(stdout, "[INFO] Display : %llu frames presented, %llu skipped, %llu rows uploaded\n",
+        (unsigned long long)disp->frames_presented, (unsigned long long)disp->frames_skipped, (unsigned long long)disp->rows_uploaded);
+}
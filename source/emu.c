@@ -5,28 +5,51 @@
 #include "consts.h"
 #include "cpu.h"
 #include "render_engine.h"
+#include "savestate.h"
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
-void emu_init(Emulator* emu) {
-    audiopl_init(&emu->audiopl);
-    mem_init(&emu->mem);
-    cpu_init(&emu->cpu);
-    re_init(&emu->re);
+void emu_init(Emulator* emu, QuirkProfile quirks) {
+    // Zeroed padding, see emu_hash_state().
+    memset(&emu->state, 0, sizeof(emu->state));
+    mem_init(&emu->state.mem);
+    cpu_init(&emu->state.cpu);
+    emu->state.cpu.quirks = quirks;
+    emu->cpu_core = cpu_select_core(quirks);
+    emu->state.cycle = 0;
+    emu->state.ipf = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    kevq_init(&emu->state.key_events);
+    re_init(&emu->state.re);
+    emu->on_beep = NULL;
+    emu->beep_user_data = NULL;
+#ifdef CVM8_JIT
+    jit_init(&emu->jit);
+#endif
 }
 
 void emu_deinit(Emulator* emu) {
-    audiopl_deinit(&emu->audiopl);
-    cpu_deinit(&emu->cpu);
+#ifdef CVM8_JIT
+    jit_deinit(&emu->jit);
+#endif
 }
 
-void emu_load_rom_from_file(Emulator* emu, char* rom_path) {
+bool emu_load_rom(Emulator* emu, const uint8_t* rom_buf, size_t rom_size) {
+    if (rom_size > MAX_ROM_SIZE) {
+        fprintf(stderr, "[ERROR] Your ROM exceeds the max rom size !\n");
+        return false;
+    }
+
+    mem_load_rom(&emu->state.mem, rom_buf, rom_size);
+    return true;
+}
+
+bool emu_load_rom_from_file(Emulator* emu, const char* rom_path) {
     FILE* rom_file = fopen(rom_path, "rb");
 
     if (rom_file == NULL) {
-        fprintf(stderr, "[FATAL ERROR] Unable to open the ROM file !\n");
-        emu_deinit(emu);
-        exit(EXIT_FAILURE); // Ugly, don't care.
+        fprintf(stderr, "[ERROR] Unable to open the ROM file !\n");
+        return false;
     }
 
     fseek(rom_file, 0, SEEK_END);
@@ -35,41 +58,298 @@ void emu_load_rom_from_file(Emulator* emu, char* rom_path) {
 
     if (rom_buf_size > MAX_ROM_SIZE) {
         fclose(rom_file);
-        fprintf(stderr, "[FATAL ERROR] Your ROM exceeds the max rom size !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
-    }
-
-    // Load FONTSET before anything else.
-    for (uint8_t i = 0; i < FONTSET_SIZE; i++) {
-        mem_write(&emu->mem, i, FONTSET[i]);
+        fprintf(stderr, "[ERROR] Your ROM exceeds the max rom size !\n");
+        return false;
     }
 
     uint8_t* rom_buf = (uint8_t*) malloc(rom_buf_size * sizeof(uint8_t));
     if (rom_buf == NULL) {
         fclose(rom_file);
-        fprintf(stderr, "[FATAL ERROR] Memory Allocation Error !\n");
-        emu_deinit(emu);
-        exit(EXIT_FAILURE); // Ugly, don't care.
+        fprintf(stderr, "[ERROR] Memory Allocation Error !\n");
+        return false;
     }
 
-    fread(rom_buf, rom_buf_size, 1, rom_file);
+    size_t read = fread(rom_buf, 1, rom_buf_size, rom_file);
     fclose(rom_file);
 
-    for (size_t idx = 0; idx < rom_buf_size; idx++) {
-        mem_write(&emu->mem, idx + CPU_INTERNAL_PROGRAM_COUNTER_START, rom_buf[idx]);
-    }
+    bool loaded = read == rom_buf_size && emu_load_rom(emu, rom_buf, rom_buf_size);
+    if (read != rom_buf_size) fprintf(stderr, "[ERROR] Unable to read the ROM file !\n");
 
     free(rom_buf);
+    return loaded;
 }
 
 bool emu_re_is_pixel_on(Emulator* emu, uint8_t x, uint8_t y) {
-    return re_is_pixel_on(&emu->re, x, y);
+    return re_is_pixel_on(&emu->state.re, x, y);
+}
+
+uint64_t emu_re_generation(Emulator* emu) {
+    return emu->state.re.generation;
+}
+
+void emu_set_key(Emulator* emu, uint8_t key, bool pressed) {
+    cpu_set_key(&emu->state.cpu, key, pressed);
+}
+
+bool emu_queue_key(Emulator* emu, uint64_t cycle, uint8_t key, bool pressed) {
+    return kevq_push(&emu->state.key_events, (KeyEvent){ .cycle = cycle, .key = key, .pressed = pressed });
+}
+
+void emu_set_ipf(Emulator* emu, uint32_t ipf) {
+    emu->state.ipf = ipf > 0 ? ipf : 1;
+}
+
+// The ticks the cycle went through since the CPU last looked, each one
+// a vblank too.
+static void emu_sync_ticks(Emulator* emu) {
+    uint64_t ticks = emu->state.cycle / emu->state.ipf;
+    if (ticks <= emu->state.cpu.timer_ticks) return;
+
+    emu->state.cpu.vblank_wait = 0;
+    if (cpu_tick_timers(&emu->state.cpu, ticks - emu->state.cpu.timer_ticks) && emu->on_beep != NULL) emu->on_beep(emu->beep_user_data);
+}
+
+CpuTrap emu_do_cpu_cycle(Emulator* emu) {
+    return emu_do_cpu_cycles(emu, 1);
+}
+
+// One uninterrupted batch through whichever core applies.
+static CpuTrap emu_run_batch(Emulator* emu, uint32_t cycles) {
+    // Halted in Fx0A, only timers and keys move until a key comes.
+    if (cpu_is_halted(&emu->state.cpu)) return CPU_TRAP_NONE;
+
+    cpu_begin_step(&emu->state.cpu);
+#if defined(CVM8_AOT) || defined(CVM8_JIT)
+    // Translated code is only generated for the default quirks.
+    if (quirks_are_default(emu->state.cpu.quirks)) {
+#if defined(CVM8_AOT)
+        aot_run_cycles(&emu->state.cpu, &emu->state.mem, &emu->state.re, cycles);
+#else
+        jit_run_cycles(&emu->jit, &emu->state.cpu, &emu->state.mem, &emu->state.re, cycles);
+#endif
+        return cpu_end_step(&emu->state.cpu);
+    }
+#endif
+    emu->cpu_core(&emu->state.cpu, &emu->state.mem, &emu->state.re, cycles);
+    return cpu_end_step(&emu->state.cpu);
+}
+
+// Applies whatever is due at emu->state.cycle, returns the stamp of the next
+// event or UINT64_MAX.
+static uint64_t emu_apply_due_keys(Emulator* emu) {
+    KeyEvent ev;
+    while (kevq_peek(&emu->state.key_events, &ev)) {
+        if (ev.cycle > emu->state.cycle) return ev.cycle;
+
+        cpu_set_key(&emu->state.cpu, ev.key, ev.pressed);
+        kevq_drop(&emu->state.key_events);
+    }
+
+    return UINT64_MAX;
+}
+
+CpuTrap emu_do_cpu_cycles(Emulator* emu, uint32_t cycles) {
+    uint64_t end = emu->state.cycle + cycles;
+
+    while (true) {
+        // Batches end at key stamps and ticks, so the timers never move
+        // under one and an idle loop never gets elided past a tick.
+        uint64_t next = emu_apply_due_keys(emu);
+        uint64_t tick_end = (emu->state.cycle / emu->state.ipf + 1) * emu->state.ipf;
+        if (next > tick_end) next = tick_end;
+        if (next > end) next = end;
+
+        uint32_t budget = (uint32_t)(next - emu->state.cycle);
+        // After a display_wait draw, keys still apply on time but nothing
+        // runs until the tick.
+        if (budget > 0 && !emu->state.cpu.vblank_wait) {
+            CpuTrap trap = emu_run_batch(emu, budget);
+
+            if (trap != CPU_TRAP_NONE) {
+                emu->state.cycle = end;
+                emu_sync_ticks(emu);
+                return trap;
+            }
+        }
+
+        emu->state.cycle = next;
+        emu_sync_ticks(emu);
+        if (next == end) return CPU_TRAP_NONE;
+    }
+}
+
+bool emu_skip_halted_frames(Emulator* emu, uint32_t frames) {
+    if (!cpu_is_halted(&emu->state.cpu) || kevq_count(&emu->state.key_events) > 0) return false;
+
+    emu->state.cycle += (uint64_t)frames * emu->state.ipf;
+    emu_sync_ticks(emu);
+    return true;
+}
+
+void emu_print_fusion_report(Emulator* emu, const char* rom_path) {
+    uint64_t retired = emu->state.cpu.retired_ops;
+    uint64_t fused = emu->state.cpu.fused_ops;
+    uint64_t idle = emu->state.cpu.idle_ops;
+
+    fprintf(stdout, "[INFO] %s : %llu / %llu instructions covered by fused ops (%.1f%%)\n", rom_path,
+        (unsigned long long)fused, (unsigned long long)retired, retired == 0 ? 0.0 : 100.0 * fused / retired);
+    fprintf(stdout, "[INFO] %s : %llu / %llu instructions elided in idle loops (%.1f%%)\n", rom_path,
+        (unsigned long long)idle, (unsigned long long)retired, retired == 0 ? 0.0 : 100.0 * idle / retired);
+}
+
+void emu_copy_state(Emulator* dst, const Emulator* src) {
+    memcpy(&dst->state, &src->state, sizeof(dst->state));
+    dst->cpu_core = cpu_select_core(dst->state.cpu.quirks);
+#ifdef CVM8_JIT
+    // src's code map describes src's blocks, none of dst's are valid anymore.
+    jit_flush_all(&dst->jit, &dst->state.mem);
+#endif
+}
+
+// Four interleaved FNV-1a lanes, one multiply chain each instead of a
+// single long one, folded together at the end.
+static uint64_t emu_hash_bytes(const uint8_t* bytes, size_t size) {
+    uint64_t h0 = 0xCBF29CE484222325ULL, h1 = 0x84222325CBF29CE4ULL, h2 = 0xE484222325CBF29CULL, h3 = 0x2325CBF29CE48422ULL;
+    size_t i = 0;
+
+    for (; i + 4 * sizeof(uint64_t) <= size; i += 4 * sizeof(uint64_t)) {
+        uint64_t w[4];
+        memcpy(w, bytes + i, sizeof(w));
+        h0 = (h0 ^ w[0]) * 0x100000001B3ULL;
+        h1 = (h1 ^ w[1]) * 0x100000001B3ULL;
+        h2 = (h2 ^ w[2]) * 0x100000001B3ULL;
+        h3 = (h3 ^ w[3]) * 0x100000001B3ULL;
+    }
+
+    uint64_t hash = (((h0 ^ h1) * 0x100000001B3ULL ^ h2) * 0x100000001B3ULL ^ h3) * 0x100000001B3ULL;
+    for (; i < size; i++) hash = (hash ^ bytes[i]) * 0x100000001B3ULL;
+
+    return hash;
+}
+
+uint64_t emu_hash_state(const Emulator* emu) {
+    return emu_hash_bytes((const uint8_t*)&emu->state, MACHINE_STATE_SAVED_SIZE);
 }
 
-void emu_update_cpu_timers(Emulator* emu) {
-    cpu_update_timers(&emu->cpu, &emu->audiopl);
+static bool emu_host_is_little_endian(void) {
+    const uint16_t probe = 1;
+    return *(const uint8_t*)&probe == 1;
+}
+
+static void emu_fill_savestate_header(SaveStateHeader* header, uint64_t checksum) {
+    memset(header, 0, sizeof(*header));
+    memcpy(header->magic, SAVESTATE_MAGIC, SAVESTATE_MAGIC_SIZE);
+    header->version = SAVESTATE_VERSION;
+    header->header_size = sizeof(SaveStateHeader);
+    header->payload_size = MACHINE_STATE_SAVED_SIZE;
+    header->cpu_size = sizeof(CPU);
+    header->re_size = sizeof(RenderEngine);
+    header->key_events_size = sizeof(KeyEventQueue);
+    header->mem_offset = offsetof(MachineState, mem);
+    header->checksum = checksum;
+}
+
+bool emu_save_state(const Emulator* emu, const char* path) {
+    if (!emu_host_is_little_endian()) {
+        fprintf(stderr, "[ERROR] Save states need a little-endian host !\n");
+        return false;
+    }
+
+    SaveStateFile file;
+    emu_fill_savestate_header(&file.header, emu_hash_state(emu));
+    memcpy(file.payload, &emu->state, MACHINE_STATE_SAVED_SIZE);
+
+    FILE* state_file = fopen(path, "wb");
+    if (state_file == NULL) {
+        fprintf(stderr, "[ERROR] Unable to open the save state file !\n");
+        return false;
+    }
+
+    bool saved = fwrite(&file, 1, SAVESTATE_FILE_SIZE, state_file) == SAVESTATE_FILE_SIZE;
+    saved &= fclose(state_file) == 0;
+    if (!saved) fprintf(stderr, "[ERROR] Unable to write the save state file !\n");
+
+    return saved;
 }
 
-void emu_do_cpu_cycle(Emulator* emu) {
-    cpu_decode_and_execute(&emu->cpu, &emu->mem, &emu->re);
+// A bool holding anything but 0 or 1 is undefined behaviour, check the bytes.
+static bool emu_bytes_are_bools(const void* bytes, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (((const uint8_t*)bytes)[i] > 1) return false;
+    }
+    return true;
+}
+
+// The checksum only catches damage, these are the invariants the core
+// indexes arrays with, a crafted file must not get past them.
+static bool emu_saved_machine_is_sane(const uint8_t* payload) {
+    CPU cpu;
+    KeyEventQueue key_events;
+    uint32_t ipf;
+    memcpy(&cpu, payload + offsetof(MachineState, cpu), sizeof(cpu));
+    memcpy(&key_events, payload + offsetof(MachineState, key_events), sizeof(key_events));
+    memcpy(&ipf, payload + offsetof(MachineState, ipf), sizeof(ipf));
+
+    if (!emu_bytes_are_bools(payload + offsetof(MachineState, cpu) + offsetof(CPU, quirks), sizeof(QuirkProfile))) return false;
+    if (ipf == 0) return false;
+    if (cpu.sp > CPU_STACK_DEPTH || cpu.trap > CPU_TRAP_UNIMPLEMENTED_OPCODE || cpu.rng_state == 0) return false;
+    if (cpu.key_wait > KEY_WAIT_RELEASE || cpu.key_wait_reg >= REGS_COUNT || cpu.key_wait_key >= KEYS_COUNT) return false;
+    if (kevq_count(&key_events) > KEY_EVENTS_CAPACITY) return false;
+
+    for (uint32_t i = key_events.head; i != key_events.tail; i++) {
+        size_t at = offsetof(MachineState, key_events) + offsetof(KeyEventQueue, events)
+            + (i & (KEY_EVENTS_CAPACITY - 1)) * sizeof(KeyEvent);
+        if (key_events.events[i & (KEY_EVENTS_CAPACITY - 1)].key >= KEYS_COUNT) return false;
+        if (!emu_bytes_are_bools(payload + at + offsetof(KeyEvent, pressed), sizeof(bool))) return false;
+    }
+
+    return true;
+}
+
+bool emu_load_state(Emulator* emu, const char* path) {
+    if (!emu_host_is_little_endian()) {
+        fprintf(stderr, "[ERROR] Save states need a little-endian host !\n");
+        return false;
+    }
+
+    FILE* state_file = fopen(path, "rb");
+    if (state_file == NULL) {
+        fprintf(stderr, "[ERROR] Unable to open the save state file !\n");
+        return false;
+    }
+
+    // One read of the exact size, anything shorter or longer is not ours.
+    SaveStateFile file;
+    size_t read = fread(&file, 1, SAVESTATE_FILE_SIZE, state_file);
+    bool at_end = fgetc(state_file) == EOF;
+    fclose(state_file);
+
+    SaveStateHeader expected;
+    emu_fill_savestate_header(&expected, file.header.checksum);
+
+    if (read != SAVESTATE_FILE_SIZE || !at_end || memcmp(file.header.magic, SAVESTATE_MAGIC, SAVESTATE_MAGIC_SIZE) != 0) {
+        fprintf(stderr, "[ERROR] Not a save state file !\n");
+        return false;
+    }
+    if (memcmp(&file.header, &expected, sizeof(expected)) != 0) {
+        fprintf(stderr, "[ERROR] Save state from another version or build (version %u) !\n", file.header.version);
+        return false;
+    }
+    if (emu_hash_bytes(file.payload, MACHINE_STATE_SAVED_SIZE) != file.header.checksum) {
+        fprintf(stderr, "[ERROR] Save state checksum mismatch, the file is damaged !\n");
+        return false;
+    }
+    if (!emu_saved_machine_is_sane(file.payload)) {
+        fprintf(stderr, "[ERROR] Save state holds an impossible machine !\n");
+        return false;
+    }
+
+    memcpy(&emu->state, file.payload, MACHINE_STATE_SAVED_SIZE);
+    // Every slot becomes OP_UNDECODED, they refill from the loaded memory.
+    memset(emu->state.mem.decoded_ops, 0, sizeof(emu->state.mem.decoded_ops));
+    emu->cpu_core = cpu_select_core(emu->state.cpu.quirks);
+#ifdef CVM8_JIT
+    jit_flush_all(&emu->jit, &emu->state.mem);
+#endif
+    return true;
 }
@@ -0,0 +1,43 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "input_queue.h"
+
+_Static_assert((INQ_CAPACITY & (INQ_CAPACITY - 1)) == 0, "The input queue capacity must be a power of two !");
+
+void inq_init(InputQueue* inq) {
+    atomic_init(&inq->head, 0);
+    atomic_init(&inq->tail, 0);
+    inq->dropped = 0;
+}
+
+// Each side only writes its own index, release publishes the event (or
+// frees its slot) before the index moves.
+bool inq_push(InputQueue* inq, InputEvent ev) {
+    uint32_t tail = atomic_load_explicit(&inq->tail, memory_order_relaxed);
+    if (tail - atomic_load_explicit(&inq->head, memory_order_acquire) == INQ_CAPACITY) {
+        inq->dropped++;
+        return false;
+    }
+
+    inq->events[tail & (INQ_CAPACITY - 1)] = ev;
+    atomic_store_explicit(&inq->tail, tail + 1, memory_order_release);
+    return true;
+}
+
+bool inq_peek(InputQueue* inq, InputEvent* ev) {
+    uint32_t head = atomic_load_explicit(&inq->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&inq->tail, memory_order_acquire)) return false;
+
+    *ev = inq->events[head & (INQ_CAPACITY - 1)];
+    return true;
+}
+
+bool inq_pop(InputQueue* inq, InputEvent* ev) {
+    uint32_t head = atomic_load_explicit(&inq->head, memory_order_relaxed);
+    if (head == atomic_load_explicit(&inq->tail, memory_order_acquire)) return false;
+
+    *ev = inq->events[head & (INQ_CAPACITY - 1)];
+    atomic_store_explicit(&inq->head, head + 1, memory_order_release);
+    return true;
+}
@@ -0,0 +1,695 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+// MAP_ANONYMOUS isn't POSIX 2008, glibc hides it under a strict -std=c2x.
+#define _DEFAULT_SOURCE
+
+#ifdef CVM8_JIT
+
+#include "jit.h"
+#include "cpu.h"
+#include "decoder.h"
+#include "mem.h"
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+// Host registers, x86-64 encoding numbers.
+enum {
+    HOST_RAX = 0, HOST_RCX, HOST_RDX, HOST_RBX, HOST_RSP, HOST_RBP, HOST_RSI, HOST_RDI,
+    HOST_R8, HOST_R9, HOST_R10, HOST_R11, HOST_R12, HOST_R13, HOST_R14, HOST_R15,
+};
+
+// RDI holds the CPU* (first SysV argument) and RAX is scratch,
+// everything else can hold a V register or I.
+static const uint8_t JIT_REG_POOL[] = {
+    HOST_RCX, HOST_RDX, HOST_RSI, HOST_R8, HOST_R9, HOST_R10, HOST_R11,
+    HOST_RBX, HOST_RBP, HOST_R12, HOST_R13, HOST_R14, HOST_R15,
+};
+#define JIT_REG_POOL_SIZE (sizeof(JIT_REG_POOL) / sizeof(JIT_REG_POOL[0]))
+#define JIT_NO_REG 0xFF
+#define JIT_I_SLOT REGS_COUNT // Guest slot used for I, after V0 -> VF.
+// Bound on one op's code, its write backs and interpreter call included,
+// also enough for the prologue and epilogue.
+#define JIT_MAX_OP_BYTES 256
+
+// x86 condition codes.
+#define CC_E 0x4
+#define CC_NE 0x5
+#define CC_A 0x7
+
+// ALU /digit extensions for 0x81 and 0xC1.
+#define ALU_ADD 0
+#define ALU_AND 4
+#define ALU_CMP 7
+#define SHIFT_SHL 4
+#define SHIFT_SHR 5
+
+typedef struct {
+    uint8_t* buf;
+    size_t len;
+    uint8_t host_of[REGS_COUNT + 1]; // Guest slot -> host register.
+    uint32_t dirty; // Guest slots to write back.
+    uint8_t pool_used;
+    uint8_t pool_peak; // Highest pool_used before an interpreter call reset it.
+    bool calls; // The block calls back into the interpreter.
+    // rel32 jumps to the epilogue, patched once the body is done.
+    size_t exit_patches[JIT_MAX_BLOCK_OPS];
+    uint8_t exit_patch_count;
+} JitEmitter;
+
+static bool jit_is_callee_saved(uint8_t reg) {
+    return reg == HOST_RBX || reg == HOST_RBP || reg >= HOST_R12;
+}
+
+static void emit8(JitEmitter* e, uint8_t b) {
+    e->buf[e->len++] = b;
+}
+
+static void emit16(JitEmitter* e, uint16_t v) {
+    emit8(e, v & 0xFF);
+    emit8(e, v >> 8);
+}
+
+static void emit32(JitEmitter* e, uint32_t v) {
+    for (uint8_t i = 0; i < 4; i++) emit8(e, (v >> (i * 8)) & 0xFF);
+}
+
+static void emit64(JitEmitter* e, uint64_t v) {
+    emit32(e, (uint32_t)v);
+    emit32(e, (uint32_t)(v >> 32));
+}
+
+static void emit_rex(JitEmitter* e, uint8_t reg, uint8_t rm, bool force) {
+    uint8_t rex = 0x40 | ((reg >> 3) << 2) | (rm >> 3);
+    if (rex != 0x40 || force) emit8(e, rex);
+}
+
+static void emit_modrm(JitEmitter* e, uint8_t mod, uint8_t reg, uint8_t rm) {
+    emit8(e, (mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+// op r/m32, r32 (mov 0x89, or 0x09, and 0x21, xor 0x31, add 0x01, sub 0x29, cmp 0x39).
+static void emit_rr(JitEmitter* e, uint8_t opcode, uint8_t dst, uint8_t src) {
+    emit_rex(e, src, dst, false);
+    emit8(e, opcode);
+    emit_modrm(e, 3, src, dst);
+}
+
+static void emit_mov_ri(JitEmitter* e, uint8_t dst, uint32_t imm) {
+    emit_rex(e, 0, dst, false);
+    emit8(e, 0xB8 + (dst & 7));
+    emit32(e, imm);
+}
+
+// movabs r64, imm64
+static void emit_mov_ri64(JitEmitter* e, uint8_t dst, uint64_t imm) {
+    emit8(e, 0x48 | (dst >> 3));
+    emit8(e, 0xB8 + (dst & 7));
+    emit64(e, imm);
+}
+
+static void emit_alu_ri(JitEmitter* e, uint8_t ext, uint8_t dst, uint32_t imm) {
+    emit_rex(e, 0, dst, false);
+    emit8(e, 0x81);
+    emit_modrm(e, 3, ext, dst);
+    emit32(e, imm);
+}
+
+static void emit_shift_ri(JitEmitter* e, uint8_t ext, uint8_t dst, uint8_t imm) {
+    emit_rex(e, 0, dst, false);
+    emit8(e, 0xC1);
+    emit_modrm(e, 3, ext, dst);
+    emit8(e, imm);
+}
+
+// movzx r32, byte/word [rdi + disp32].
+static void emit_load_cpu(JitEmitter* e, uint8_t dst, uint32_t disp, bool word) {
+    emit_rex(e, dst, HOST_RDI, false);
+    emit8(e, 0x0F);
+    emit8(e, word ? 0xB7 : 0xB6);
+    emit_modrm(e, 2, dst, HOST_RDI);
+    emit32(e, disp);
+}
+
+// mov byte/word [rdi + disp32], r. REX is forced on byte stores
+// so SIL/BPL are used instead of DH/CH.
+static void emit_store_cpu(JitEmitter* e, uint32_t disp, uint8_t src, bool word) {
+    if (word) emit8(e, 0x66);
+    emit_rex(e, src, HOST_RDI, !word);
+    emit8(e, word ? 0x89 : 0x88);
+    emit_modrm(e, 2, src, HOST_RDI);
+    emit32(e, disp);
+}
+
+// op r64, [rdi + disp32] or op [rdi + disp32], r64 (mov load 0x8B,
+// mov store 0x89, add 0x03, sub 0x2B).
+static void emit_cpu_q(JitEmitter* e, uint8_t opcode, uint8_t reg, uint32_t disp) {
+    emit8(e, 0x48 | ((reg >> 3) << 2));
+    emit8(e, opcode);
+    emit_modrm(e, 2, reg, HOST_RDI);
+    emit32(e, disp);
+}
+
+static void emit_store_pc(JitEmitter* e, uint16_t pc) {
+    emit8(e, 0x66);
+    emit8(e, 0xC7);
+    emit_modrm(e, 2, 0, HOST_RDI);
+    emit32(e, offsetof(CPU, pc));
+    emit16(e, pc);
+}
+
+// setcc al ; movzx eax, al
+static void emit_setcc_eax(JitEmitter* e, uint8_t cc) {
+    emit8(e, 0x0F);
+    emit8(e, 0x90 | cc);
+    emit8(e, 0xC0);
+    emit8(e, 0x0F);
+    emit8(e, 0xB6);
+    emit8(e, 0xC0);
+}
+
+static void emit_push(JitEmitter* e, uint8_t reg) {
+    emit_rex(e, 0, reg, false);
+    emit8(e, 0x50 + (reg & 7));
+}
+
+static void emit_pop(JitEmitter* e, uint8_t reg) {
+    emit_rex(e, 0, reg, false);
+    emit8(e, 0x58 + (reg & 7));
+}
+
+static uint32_t jit_guest_offset(uint8_t slot) {
+    return slot == JIT_I_SLOT ? offsetof(CPU, index_reg) : offsetof(CPU, v_regs) + slot;
+}
+
+// Host register holding a guest slot, loaded on first use.
+static uint8_t jit_reg(JitEmitter* e, uint8_t slot) {
+    if (e->host_of[slot] == JIT_NO_REG) {
+        e->host_of[slot] = JIT_REG_POOL[e->pool_used++];
+        emit_load_cpu(e, e->host_of[slot], jit_guest_offset(slot), slot == JIT_I_SLOT);
+    }
+
+    return e->host_of[slot];
+}
+
+static uint8_t jit_reg_w(JitEmitter* e, uint8_t slot) {
+    e->dirty |= 1u << slot;
+    return jit_reg(e, slot);
+}
+
+static uint8_t jit_new_regs_needed(JitEmitter* e, const DecodedOp* d_op) {
+    uint8_t slots[4] = { d_op->x, d_op->y, 0xF, JIT_I_SLOT };
+    uint8_t needed = 0;
+
+    for (uint8_t i = 0; i < 4; i++) {
+        bool seen = false;
+        for (uint8_t j = 0; j < i; j++) seen |= slots[j] == slots[i];
+        if (!seen && e->host_of[slots[i]] == JIT_NO_REG) needed++;
+    }
+
+    return needed;
+}
+
+// Run from the block through cpu_decode_and_execute(), the block's
+// registers written back first and reloaded after.
+static bool jit_calls_interpreter(const DecodedOp* d_op) {
+    switch (d_op->handler) {
+        case OP_CLS:
+        case OP_RET:
+        case OP_CALL_ADDR:
+        case OP_JP_V0_ADDR:
+        case OP_RND_VX_BYTE:
+        case OP_DRW_VX_VY_N:
+        case OP_SKP_VX:
+        case OP_SKNP_VX:
+        case OP_LD_VX_K:
+        case OP_LD_B_VX:
+        case OP_LD_MEM_I_VX:
+        case OP_LD_VX_MEM_I:
+        case OP_LD_AUDIO_I:
+        case OP_LD_PITCH_VX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static bool jit_is_translatable(const DecodedOp* d_op) {
+    if (jit_calls_interpreter(d_op)) return true;
+
+    switch (d_op->handler) {
+        case OP_JP_ADDR:
+        case OP_SE_VX_BYTE:
+        case OP_SNE_VX_BYTE:
+        case OP_SE_VX_VY:
+        case OP_SNE_VX_VY:
+        case OP_LD_VX_BYTE:
+        case OP_ADD_VX_BYTE:
+        case OP_LD_VX_VY:
+        case OP_OR_VX_VY:
+        case OP_AND_VX_VY:
+        case OP_XOR_VX_VY:
+        case OP_ADD_VX_VY:
+        case OP_SUB_VX_VY:
+        case OP_SHR_VX:
+        case OP_SUBN_VX_VY:
+        case OP_SHL_VX:
+        case OP_LD_I_ADDR:
+        case OP_LD_VX_DT:
+        case OP_LD_DT_VX:
+        case OP_LD_ST_VX:
+        case OP_ADD_I_VX:
+        case OP_LD_F_VX:
+            return true;
+        default:
+            // Unknown opcodes, the interpreter raises their trap.
+            return false;
+    }
+}
+
+static bool jit_is_terminator(const DecodedOp* d_op) {
+    switch (d_op->handler) {
+        case OP_JP_ADDR:
+        case OP_SE_VX_BYTE:
+        case OP_SNE_VX_BYTE:
+        case OP_SE_VX_VY:
+        case OP_SNE_VX_VY:
+        // The PC only known at run time.
+        case OP_RET:
+        case OP_CALL_ADDR:
+        case OP_JP_V0_ADDR:
+        case OP_SKP_VX:
+        case OP_SKNP_VX:
+        case OP_LD_VX_K:
+        // Memory writes, may have changed the rest of this very block.
+        case OP_LD_B_VX:
+        case OP_LD_MEM_I_VX:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// Straight-line ops, same ordering as the cpu_op_* handlers so
+// VF ends up identical when x or y is 0xF.
+static void jit_emit_op(JitEmitter* e, const DecodedOp* d_op) {
+    uint8_t vx, vy, vf, ri;
+
+    switch (d_op->handler) {
+        case OP_LD_VX_BYTE:
+            emit_mov_ri(e, jit_reg_w(e, d_op->x), d_op->nn);
+            break;
+        case OP_ADD_VX_BYTE:
+            vx = jit_reg_w(e, d_op->x);
+            emit_alu_ri(e, ALU_ADD, vx, d_op->nn);
+            emit_alu_ri(e, ALU_AND, vx, 0xFF);
+            break;
+        case OP_LD_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            emit_rr(e, 0x89, jit_reg_w(e, d_op->x), vy);
+            break;
+        case OP_OR_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            emit_rr(e, 0x09, jit_reg_w(e, d_op->x), vy);
+            break;
+        case OP_AND_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            emit_rr(e, 0x21, jit_reg_w(e, d_op->x), vy);
+            break;
+        case OP_XOR_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            emit_rr(e, 0x31, jit_reg_w(e, d_op->x), vy);
+            break;
+        case OP_ADD_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            vx = jit_reg_w(e, d_op->x);
+            vf = jit_reg_w(e, 0xF);
+            emit_rr(e, 0x89, HOST_RAX, vx);
+            emit_rr(e, 0x01, HOST_RAX, vy);
+            emit_rr(e, 0x89, vf, HOST_RAX);
+            emit_shift_ri(e, SHIFT_SHR, vf, 8);
+            emit_rr(e, 0x89, vx, HOST_RAX);
+            emit_alu_ri(e, ALU_AND, vx, 0xFF);
+            break;
+        case OP_SUB_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            vx = jit_reg_w(e, d_op->x);
+            vf = jit_reg_w(e, 0xF);
+            emit_rr(e, 0x39, vx, vy);
+            emit_setcc_eax(e, CC_A);
+            emit_rr(e, 0x89, vf, HOST_RAX);
+            emit_rr(e, 0x29, vx, vy);
+            emit_alu_ri(e, ALU_AND, vx, 0xFF);
+            break;
+        case OP_SHR_VX:
+            vx = jit_reg_w(e, d_op->x);
+            vf = jit_reg_w(e, 0xF);
+            emit_rr(e, 0x89, HOST_RAX, vx);
+            emit_alu_ri(e, ALU_AND, HOST_RAX, 0x1);
+            emit_rr(e, 0x89, vf, HOST_RAX);
+            emit_shift_ri(e, SHIFT_SHR, vx, 1);
+            break;
+        case OP_SUBN_VX_VY:
+            vy = jit_reg(e, d_op->y);
+            vx = jit_reg_w(e, d_op->x);
+            vf = jit_reg_w(e, 0xF);
+            emit_rr(e, 0x39, vy, vx);
+            emit_setcc_eax(e, CC_A);
+            emit_rr(e, 0x89, vf, HOST_RAX);
+            emit_rr(e, 0x89, HOST_RAX, vy);
+            emit_rr(e, 0x29, HOST_RAX, vx);
+            emit_alu_ri(e, ALU_AND, HOST_RAX, 0xFF);
+            emit_rr(e, 0x89, vx, HOST_RAX);
+            break;
+        case OP_SHL_VX:
+            vx = jit_reg_w(e, d_op->x);
+            vf = jit_reg_w(e, 0xF);
+            emit_rr(e, 0x89, HOST_RAX, vx);
+            emit_shift_ri(e, SHIFT_SHR, HOST_RAX, 7);
+            emit_alu_ri(e, ALU_AND, HOST_RAX, 0x1);
+            emit_rr(e, 0x89, vf, HOST_RAX);
+            emit_shift_ri(e, SHIFT_SHL, vx, 1);
+            emit_alu_ri(e, ALU_AND, vx, 0xFF);
+            break;
+        case OP_LD_I_ADDR:
+            emit_mov_ri(e, jit_reg_w(e, JIT_I_SLOT), d_op->nnn);
+            break;
+        case OP_LD_VX_DT:
+            // Timers stay in memory as expiry ticks, see cpu_delay_timer().
+            vx = jit_reg_w(e, d_op->x);
+            emit_cpu_q(e, 0x8B, HOST_RAX, offsetof(CPU, delay_expiry));
+            emit_cpu_q(e, 0x2B, HOST_RAX, offsetof(CPU, timer_ticks));
+            emit8(e, 0x73); // jae over the xor, already expired otherwise.
+            emit8(e, 2);
+            emit_rr(e, 0x31, HOST_RAX, HOST_RAX);
+            emit_rr(e, 0x89, vx, HOST_RAX);
+            break;
+        case OP_LD_DT_VX:
+        case OP_LD_ST_VX:
+            // 32-bit mov zero extends, rax = timer_ticks + Vx.
+            emit_rr(e, 0x89, HOST_RAX, jit_reg(e, d_op->x));
+            emit_cpu_q(e, 0x03, HOST_RAX, offsetof(CPU, timer_ticks));
+            emit_cpu_q(e, 0x89, HOST_RAX, d_op->handler == OP_LD_DT_VX ? offsetof(CPU, delay_expiry) : offsetof(CPU, sound_expiry));
+            break;
+        case OP_ADD_I_VX:
+            vx = jit_reg(e, d_op->x);
+            ri = jit_reg_w(e, JIT_I_SLOT);
+            emit_rr(e, 0x01, ri, vx);
+            emit_alu_ri(e, ALU_AND, ri, 0xFFFF);
+            break;
+        case OP_LD_F_VX:
+            vx = jit_reg(e, d_op->x);
+            ri = jit_reg_w(e, JIT_I_SLOT);
+            emit_rr(e, 0x89, HOST_RAX, vx);
+            emit_shift_ri(e, SHIFT_SHL, HOST_RAX, 2);
+            emit_rr(e, 0x01, HOST_RAX, vx);
+            emit_rr(e, 0x89, ri, HOST_RAX);
+            break;
+        default:
+            break;
+    }
+}
+
+static uint8_t jit_callee_saved_count(uint8_t pool_used) {
+    uint8_t count = 0;
+    for (uint8_t i = 0; i < pool_used; i++) count += jit_is_callee_saved(JIT_REG_POOL[i]);
+    return count;
+}
+
+// Entered with rsp 8 off a 16 byte boundary, the call sequence pushes
+// RDI, an odd count of pushes here needs 8 more bytes to keep calls aligned.
+static bool jit_needs_stack_pad(uint8_t pool_used, bool calls) {
+    return calls && (jit_callee_saved_count(pool_used) & 1) != 0;
+}
+
+static void jit_emit_prologue(JitEmitter* e, uint8_t pool_used, bool calls) {
+    for (uint8_t i = 0; i < pool_used; i++) {
+        if (jit_is_callee_saved(JIT_REG_POOL[i])) emit_push(e, JIT_REG_POOL[i]);
+    }
+
+    if (jit_needs_stack_pad(pool_used, calls)) {
+        emit8(e, 0x48); // sub rsp, 8
+        emit8(e, 0x83);
+        emit8(e, 0xEC);
+        emit8(e, 8);
+    }
+}
+
+static void jit_emit_writeback(JitEmitter* e) {
+    for (uint8_t slot = 0; slot <= JIT_I_SLOT; slot++) {
+        if ((e->dirty & (1u << slot)) != 0) {
+            emit_store_cpu(e, jit_guest_offset(slot), e->host_of[slot], slot == JIT_I_SLOT);
+        }
+    }
+}
+
+static void jit_emit_epilogue(JitEmitter* e, uint8_t pool_used, bool calls) {
+    if (jit_needs_stack_pad(pool_used, calls)) {
+        emit8(e, 0x48); // add rsp, 8
+        emit8(e, 0x83);
+        emit8(e, 0xC4);
+        emit8(e, 8);
+    }
+
+    for (int i = pool_used - 1; i >= 0; i--) {
+        if (jit_is_callee_saved(JIT_REG_POOL[i])) emit_pop(e, JIT_REG_POOL[i]);
+    }
+
+    emit8(e, 0xC3); // ret
+}
+
+static void jit_emit_terminator(JitEmitter* e, const DecodedOp* d_op, uint16_t addr) {
+    uint8_t skip_cc;
+
+    switch (d_op->handler) {
+        case OP_JP_ADDR:
+            jit_emit_writeback(e);
+            emit_store_pc(e, d_op->nnn);
+            return;
+        case OP_SE_VX_BYTE:
+        case OP_SNE_VX_BYTE:
+            emit_alu_ri(e, ALU_CMP, jit_reg(e, d_op->x), d_op->nn);
+            skip_cc = d_op->handler == OP_SE_VX_BYTE ? CC_E : CC_NE;
+            break;
+        default:
+            {
+                uint8_t vy = jit_reg(e, d_op->y);
+                emit_rr(e, 0x39, jit_reg(e, d_op->x), vy);
+                skip_cc = d_op->handler == OP_SE_VX_VY ? CC_E : CC_NE;
+            }
+            break;
+    }
+
+    // Plain movs don't touch the flags set by the cmp above.
+    jit_emit_writeback(e);
+    emit_store_pc(e, addr + 2);
+    emit8(e, 0x70 | (skip_cc ^ 1)); // jcc over the skip, inverted condition.
+    size_t patch = e->len;
+    emit8(e, 0);
+    emit_store_pc(e, addr + 4);
+    e->buf[patch] = (uint8_t)(e->len - patch - 1);
+}
+
+// The op at addr through the interpreter, against the mem and re this
+// block was translated for (they live next to the Jit, never move). A
+// trap or an Fx0A halt parks the PC, anything but addr + 2 afterwards
+// leaves the block, the ops after it never ran.
+static void jit_emit_call_interpreter(JitEmitter* e, const DecodedOp* d_op, uint16_t addr, Memory* mem, RenderEngine* re) {
+    jit_emit_writeback(e);
+    emit_store_pc(e, addr);
+
+    emit8(e, 0x57); // push rdi
+    emit_mov_ri64(e, HOST_RSI, (uint64_t)(uintptr_t)mem);
+    emit_mov_ri64(e, HOST_RDX, (uint64_t)(uintptr_t)re);
+    emit_mov_ri64(e, HOST_RAX, (uint64_t)(uintptr_t)cpu_decode_and_execute);
+    emit8(e, 0xFF); // call rax
+    emit8(e, 0xD0);
+    emit8(e, 0x5F); // pop rdi
+
+    // Every guest register may have changed, reload on next use.
+    if (e->pool_used > e->pool_peak) e->pool_peak = e->pool_used;
+    memset(e->host_of, JIT_NO_REG, sizeof(e->host_of));
+    e->dirty = 0;
+    e->pool_used = 0;
+    e->calls = true;
+
+    if (jit_is_terminator(d_op)) return;
+
+    // cmp word [rdi + pc], addr + 2 ; jne epilogue
+    emit8(e, 0x66);
+    emit8(e, 0x81);
+    emit_modrm(e, 2, 7, HOST_RDI);
+    emit32(e, offsetof(CPU, pc));
+    emit16(e, addr + 2);
+    emit8(e, 0x0F);
+    emit8(e, 0x80 | CC_NE);
+    e->exit_patches[e->exit_patch_count++] = e->len;
+    emit32(e, 0);
+}
+
+void jit_flush_all(Jit* jit, Memory* mem) {
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+    memset(mem->code_map, 0, sizeof(mem->code_map));
+    mem->code_dirty = false;
+    jit->code_used = 0;
+}
+
+static void jit_drop_dirty_blocks(Jit* jit, Memory* mem) {
+    // A block starts at most JIT_MAX_BLOCK_OPS slots before the dirty range.
+    int first = (mem->code_dirty_lo >> 1) - JIT_MAX_BLOCK_OPS;
+    if (first < 0) first = 0;
+
+    for (int slot = first; slot <= (mem->code_dirty_hi >> 1); slot++) {
+        JitBlock* block = &jit->blocks[slot];
+        if (block->state != JIT_BLOCK_EMPTY && block->start <= mem->code_dirty_hi && block->end > mem->code_dirty_lo) {
+            block->state = JIT_BLOCK_EMPTY;
+        }
+    }
+
+    mem->code_dirty = false;
+}
+
+static void jit_translate(Jit* jit, Memory* mem, RenderEngine* re, JitBlock* block, uint16_t start) {
+    if (jit->code_used + JIT_MAX_BLOCK_BYTES > JIT_CODE_ARENA_SIZE) {
+        jit_flush_all(jit, mem);
+    }
+
+    // The body goes to a scratch buffer first, the prologue can only
+    // save the callee-saved registers once we know which ones got used.
+    uint8_t body[JIT_MAX_BLOCK_BYTES];
+    JitEmitter e = { .buf = body };
+    memset(e.host_of, JIT_NO_REG, sizeof(e.host_of));
+
+    uint16_t addr = start;
+    uint8_t op_count = 0;
+    bool terminated = false;
+
+    while (op_count < JIT_MAX_BLOCK_OPS && addr <= TOTAL_MEMORY_SIZE - 2) {
+        DecodedOp d_op = decoder_decode_op(mem->mem[addr] << 8 | mem->mem[addr + 1]);
+
+        if (!jit_is_translatable(&d_op)) break;
+        if (e.len + 2 * JIT_MAX_OP_BYTES > JIT_MAX_BLOCK_BYTES) break;
+        // Interpreter calls need no register.
+        bool calls = jit_calls_interpreter(&d_op);
+        if (!calls && e.pool_used + jit_new_regs_needed(&e, &d_op) > JIT_REG_POOL_SIZE) break;
+
+        mem->code_map[addr >> 1] = 1;
+        op_count++;
+
+        if (calls) {
+            jit_emit_call_interpreter(&e, &d_op, addr, mem, re);
+            addr += 2;
+            if (jit_is_terminator(&d_op)) {
+                terminated = true;
+                break;
+            }
+            continue;
+        }
+
+        if (jit_is_terminator(&d_op)) {
+            jit_emit_terminator(&e, &d_op, addr);
+            addr += 2;
+            terminated = true;
+            break;
+        }
+
+        jit_emit_op(&e, &d_op);
+        addr += 2;
+    }
+
+    block->start = start;
+    block->end = addr;
+    block->op_count = op_count;
+
+    if (op_count == 0) {
+        // Still watched, a later write might make it translatable.
+        mem->code_map[start >> 1] = 1;
+        block->end = start + 2;
+        block->state = JIT_BLOCK_INTERPRET;
+        return;
+    }
+
+    if (!terminated) {
+        jit_emit_writeback(&e);
+        emit_store_pc(&e, addr);
+    }
+
+    // The epilogue comes right after the body.
+    for (uint8_t i = 0; i < e.exit_patch_count; i++) {
+        uint32_t rel = (uint32_t)(e.len - (e.exit_patches[i] + 4));
+        memcpy(e.buf + e.exit_patches[i], &rel, sizeof(rel));
+    }
+
+    uint8_t pool_used = e.pool_used > e.pool_peak ? e.pool_used : e.pool_peak;
+    JitEmitter out = { .buf = jit->code + jit->code_used };
+    jit_emit_prologue(&out, pool_used, e.calls);
+    // Jumps are relative and stay within body + epilogue, safe to move.
+    memcpy(out.buf + out.len, body, e.len);
+    out.len += e.len;
+    jit_emit_epilogue(&out, pool_used, e.calls);
+
+    block->fn = (JitBlockFn)(void*)out.buf;
+    block->state = JIT_BLOCK_READY;
+    jit->code_used += out.len;
+}
+
+void jit_init(Jit* jit) {
+    jit->code = mmap(NULL, JIT_CODE_ARENA_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    // Without an arena everything just goes through the interpreter.
+    if (jit->code == MAP_FAILED) {
+        fprintf(stderr, "[WARNING] Unable to map the JIT code arena, interpreting only !\n");
+        jit->code = NULL;
+    }
+
+    jit->code_used = 0;
+    memset(jit->blocks, 0, sizeof(jit->blocks));
+}
+
+void jit_deinit(Jit* jit) {
+    if (jit->code != NULL) munmap(jit->code, JIT_CODE_ARENA_SIZE);
+}
+
+void jit_run_cycles(Jit* jit, CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles) {
+    // Same accounting as the cores, what a trap or a halt cut off comes back off.
+    cpu->retired_ops += cycles;
+
+    while (cycles > 0) {
+        if (mem->code_dirty) jit_drop_dirty_blocks(jit, mem);
+
+        // Odd PCs never get a block, nor do idle loops : the interpreter
+        // elides them up to the budget instead of spinning through them.
+        DecodedOp scratch;
+        if (jit->code != NULL && (cpu->pc & 0x1) == 0 && cpu->pc <= TOTAL_MEMORY_SIZE - 2
+            && cpu_fetch_decoded_op(cpu, mem, &scratch)->handler < OP_IDLE_FIRST) {
+            JitBlock* block = &jit->blocks[cpu->pc >> 1];
+            if (block->state == JIT_BLOCK_EMPTY) jit_translate(jit, mem, re, block, cpu->pc);
+
+            // Blocks are all or nothing, the tail of the budget gets interpreted.
+            if (block->state == JIT_BLOCK_READY && block->op_count <= cycles) {
+                uint16_t start = block->start;
+                block->fn(cpu);
+
+                if (cpu->pc == CPU_PARKED_PC) {
+                    // Straight line up to the op that parked it, which only
+                    // retired if it halted rather than trapped.
+                    cpu->retired_ops -= cycles - ((cpu->parked_pc - start) / 2 + 1) + (cpu->trap != CPU_TRAP_NONE);
+                    return;
+                }
+                cycles -= block->op_count;
+                continue;
+            }
+        }
+
+        cycles -= cpu_run_fallback(cpu, mem, re, cycles);
+        if (cpu->pc == CPU_PARKED_PC) {
+            cpu->retired_ops -= cycles + (cpu->trap != CPU_TRAP_NONE);
+            return;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,36 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "key_events.h"
+
+_Static_assert((KEY_EVENTS_CAPACITY & (KEY_EVENTS_CAPACITY - 1)) == 0, "The key events capacity must be a power of two !");
+
+void kevq_init(KeyEventQueue* kevq) {
+    kevq->head = 0;
+    kevq->tail = 0;
+    kevq->last_cycle = 0;
+}
+
+bool kevq_push(KeyEventQueue* kevq, KeyEvent ev) {
+    if (kevq_count(kevq) == KEY_EVENTS_CAPACITY) return false;
+
+    if (ev.cycle < kevq->last_cycle) ev.cycle = kevq->last_cycle;
+    kevq->last_cycle = ev.cycle;
+    kevq->events[kevq->tail++ & (KEY_EVENTS_CAPACITY - 1)] = ev;
+    return true;
+}
+
+bool kevq_peek(const KeyEventQueue* kevq, KeyEvent* ev) {
+    if (kevq->head == kevq->tail) return false;
+
+    *ev = kevq->events[kevq->head & (KEY_EVENTS_CAPACITY - 1)];
+    return true;
+}
+
+void kevq_drop(KeyEventQueue* kevq) {
+    if (kevq->head != kevq->tail) kevq->head++;
+}
+
+uint32_t kevq_count(const KeyEventQueue* kevq) {
+    return kevq->tail - kevq->head;
+}
@@ -1,95 +1,399 @@
 /*
     Copyright (c) 2026 - Yann BOYER
 */
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <SDL2/SDL.h>
 
-#include "emu.h"
+#include "cvm8.h"
+#include "audio.h"
+#include "display.h"
+#include "input_queue.h"
+#include "scheduler.h"
+#include "triple_buffer.h"
 #include "consts.h"
 
+#define WINDOW_TITLE "CVM8_CV by Yann BOYER"
+#define STATE_PATH_SIZE 1024
+
+// Host keys of the CHIP-8 keypad 0x0 -> 0xF, by position so it stays
+// the usual 1234/QWER/ASDF/ZXCV block whatever the layout.
+static const SDL_Scancode KEYPAD_MAP[CVM8_KEYS_COUNT] = {
+    SDL_SCANCODE_X, SDL_SCANCODE_1, SDL_SCANCODE_2, SDL_SCANCODE_3,
+    SDL_SCANCODE_Q, SDL_SCANCODE_W, SDL_SCANCODE_E, SDL_SCANCODE_A,
+    SDL_SCANCODE_S, SDL_SCANCODE_D, SDL_SCANCODE_Z, SDL_SCANCODE_C,
+    SDL_SCANCODE_4, SDL_SCANCODE_R, SDL_SCANCODE_F, SDL_SCANCODE_V,
+};
+
+// Owned by the emulation thread once started, the main thread only
+// pushes into inq (posting input_sem), takes from tbuf and clears is_running.
+typedef struct {
+    Cvm8* vm;
+    FrameScheduler sched;
+    AudioPlayer* audiopl; // NULL when there's no audio, its sound is set from this thread.
+    InputQueue inq;
+    SDL_sem* input_sem; // Posted after every push, what an idle thread sleeps on.
+    TripleBuffer tbuf;
+    _Atomic bool is_running;
+    _Atomic bool is_idle; // Asleep until input, nothing gets published meanwhile.
+    CpuTrap trap;
+    uint64_t prev_wake_ns; // Start of the previous frame.
+    uint64_t keys_dropped; // The core's key queue was full.
+    char state_path[STATE_PATH_SIZE]; // F5 saves there, F9 loads it back.
+} Emulation;
+
+// The main thread's side, events and presentation only.
+typedef struct {
+    Emulation* emu;
+    Display disp;
+    FrameScheduler sched;
+    RenderEngine shown; // Last framebuffer handed to the display.
+    uint64_t shown_frame;
+    double shown_speed; // In the window title, 0 when not in turbo.
+} Frontend;
+
+static void set_turbo(Emulation* emu, bool turbo) {
+    sched_set_turbo(&emu->sched, turbo);
+}
+
+// Sampled right after the frame's step, which ends on a timer tick, so the
+// sound starts and stops on the frame the timer does. Muted in turbo, it'd be a continuous buzz at
+// that speed.
+static void update_sound(Emulation* emu) {
+    if (emu->audiopl == NULL) return;
+
+    SoundState st;
+    cvm8_get_sound(emu->vm, &st);
+    st.on &= !emu->sched.turbo;
+    audiopl_set_sound(emu->audiopl, &st);
+}
+
+// Emulation thread, everything the main thread sent since the last call.
+// Keys seen during the previous frame period land at the same relative
+// position within this frame's batch : a constant one frame latency, and
+// the run only depends on the stamps, not on when this thread woke up.
+static void apply_input(Emulation* emu) {
+    uint64_t wake_ns = emu->sched.last_wake_ns;
+    uint64_t period_ns = wake_ns > emu->prev_wake_ns ? wake_ns - emu->prev_wake_ns : 1;
+    uint32_t ipf = emu->sched.ipf;
+    InputEvent ev;
+
+    while (inq_pop(&emu->inq, &ev)) {
+        if (ev.type == INPUT_EVENT_TURBO) {
+            set_turbo(emu, !emu->sched.turbo);
+            continue;
+        }
+        // Between two frames, the file holds a whole one.
+        if (ev.type == INPUT_EVENT_SAVE_STATE) {
+            if (cvm8_save_state(emu->vm, emu->state_path)) fprintf(stdout, "[INFO] State saved to %s\n", emu->state_path);
+            continue;
+        }
+        if (ev.type == INPUT_EVENT_LOAD_STATE) {
+            if (cvm8_load_state(emu->vm, emu->state_path)) fprintf(stdout, "[INFO] State loaded from %s\n", emu->state_path);
+            // Frames follow the loaded machine's ticks.
+            ipf = emu->sched.ipf = cvm8_get_ipf(emu->vm);
+            continue;
+        }
+
+        // Read per event, a load in between moves it.
+        uint64_t frame_cycle = cvm8_get_cycle(emu->vm);
+
+        // Late comers, pushed after this frame started, get its last cycle.
+        uint64_t offset_ns = ev.time_ns > emu->prev_wake_ns ? ev.time_ns - emu->prev_wake_ns : 0;
+        uint64_t offset = ipf == 0 ? 0 : offset_ns * ipf / period_ns;
+        if (ipf > 0 && offset >= ipf) offset = ipf - 1;
+        if (!cvm8_queue_key(emu->vm, frame_cycle + offset, ev.key, ev.pressed)) emu->keys_dropped++;
+    }
+
+    emu->prev_wake_ns = wake_ns;
+}
+
+static void publish_frame(Emulation* emu) {
+    FrameSnapshot* snap = tbuf_back(&emu->tbuf);
+    snap->fb = *cvm8_framebuffer(emu->vm);
+    snap->frame = emu->tbuf.published + 1;
+    snap->speed = emu->sched.speed;
+    snap->turbo = emu->sched.turbo;
+    snap->halted = cvm8_is_halted(emu->vm);
+    tbuf_publish(&emu->tbuf);
+}
+
+// Halted in Fx0A with the sound off, a frame only moves the cycle and the
+// timers until input comes : sleep on the queue instead of waking up every
+// frame, then take the deadlines slept through as that many frames. Only
+// those before the first event's stamp, so it lands where apply_input()
+// would have put it anyway.
+static void wait_for_input(Emulation* emu) {
+    atomic_store(&emu->is_idle, true);
+
+    InputEvent ev;
+    bool has_event;
+    while (!(has_event = inq_peek(&emu->inq, &ev)) && atomic_load_explicit(&emu->is_running, memory_order_relaxed)) {
+        SDL_SemWait(emu->input_sem);
+    }
+
+    // Frames are coming again, the main thread may be waiting on host events.
+    atomic_store(&emu->is_idle, false);
+    SDL_PushEvent(&(SDL_Event){ .type = SDL_USEREVENT });
+
+    uint64_t now_ns = sched_now_ns();
+    uint64_t skipped = sched_skip_frames(&emu->sched, has_event && ev.time_ns < now_ns ? ev.time_ns : now_ns);
+    if (skipped == 0) return;
+
+    while (skipped > 0) {
+        uint32_t frames = skipped > UINT32_MAX ? UINT32_MAX : (uint32_t)skipped;
+        cvm8_skip_halted_frames(emu->vm, frames);
+        skipped -= frames;
+    }
+    emu->prev_wake_ns = emu->sched.last_wake_ns;
+}
+
+// One frame : input, ipf instructions in one batch (ending on a timer
+// tick) and a publish, then sleep until the next deadline. Never waits on
+// the main thread, a slow present only makes it skip published frames.
+static int emulation_thread(void* user_data) {
+    Emulation* emu = (Emulation*)user_data;
+
+    while (atomic_load_explicit(&emu->is_running, memory_order_relaxed)) {
+        apply_input(emu);
+
+        CpuTrap trap = cvm8_step(emu->vm, emu->sched.ipf);
+        if (trap != CPU_TRAP_NONE) {
+            emu->trap = trap;
+            atomic_store(&emu->is_running, false);
+        }
+        update_sound(emu);
+        publish_frame(emu);
+
+        // Turbo frames aren't tied to the wall clock, nothing to catch up there.
+        if (cvm8_is_halted(emu->vm) && cvm8_pending_keys(emu->vm) == 0 && !cvm8_is_sound_on(emu->vm) && !emu->sched.turbo) {
+            wait_for_input(emu);
+        }
+        sched_wait_frame(&emu->sched);
+    }
+
+    return 0;
+}
+
+static void push_input(Emulation* emu, InputEvent ev) {
+    if (!inq_push(&emu->inq, ev)) {
+        fprintf(stderr, "[ERROR] Input queue full, dropping an event !\n");
+        return;
+    }
+    SDL_SemPost(emu->input_sem);
+}
+
+// SDL stamps events in milliseconds since its init, moved to the
+// scheduler's clock so the emulation thread can place them in a frame.
+static uint64_t event_time_ns(const SDL_Event* ev) {
+    uint32_t age_ms = SDL_GetTicks() - ev->key.timestamp;
+    return sched_now_ns() - (uint64_t)age_ms * 1000000ULL;
+}
+
+static void set_keypad_key(Emulation* emu, const SDL_Event* ev, bool pressed) {
+    for (uint8_t key = 0; key < CVM8_KEYS_COUNT; key++) {
+        if (KEYPAD_MAP[key] == ev->key.keysym.scancode) {
+            push_input(emu, (InputEvent){ .time_ns = event_time_ns(ev), .type = INPUT_EVENT_KEY, .key = key, .pressed = pressed });
+            return;
+        }
+    }
+}
+
+static void handle_event(Frontend* fe, const SDL_Event* ev) {
+    switch (ev->type) {
+        case SDL_QUIT:
+            atomic_store(&fe->emu->is_running, false);
+            SDL_SemPost(fe->emu->input_sem);
+            break;
+        case SDL_KEYDOWN:
+            if (ev->key.repeat) break;
+            // Tab toggles turbo, F5 saves the state and F9 loads it back.
+            if (ev->key.keysym.sym == SDLK_TAB) push_input(fe->emu, (InputEvent){ .type = INPUT_EVENT_TURBO });
+            else if (ev->key.keysym.sym == SDLK_F5) push_input(fe->emu, (InputEvent){ .type = INPUT_EVENT_SAVE_STATE });
+            else if (ev->key.keysym.sym == SDLK_F9) push_input(fe->emu, (InputEvent){ .type = INPUT_EVENT_LOAD_STATE });
+            else set_keypad_key(fe->emu, ev, true);
+            break;
+        case SDL_KEYUP:
+            set_keypad_key(fe->emu, ev, false);
+            break;
+        case SDL_WINDOWEVENT:
+            disp_invalidate(&fe->disp);
+            break;
+        default: break;
+    }
+}
+
+// Called every presentation frame, persistence keeps fading even when
+// no new frame got published. Frames can be skipped so the dirty rows
+// come from diffing against what's on screen. false when nothing changed.
+static bool present_latest(Frontend* fe) {
+    if (tbuf_take(&fe->emu->tbuf)) {
+        const FrameSnapshot* snap = tbuf_front(&fe->emu->tbuf);
+        uint32_t dirty_rows = fe->shown_frame == 0 ? RE_ALL_ROWS_DIRTY : re_diff_rows(&fe->shown, &snap->fb);
+        fe->shown = snap->fb;
+        fe->shown_frame = snap->frame;
+        bool presented = disp_present(&fe->disp, &fe->shown, dirty_rows);
+
+        double speed = snap->turbo ? snap->speed : 0.0;
+        if (speed != fe->shown_speed) {
+            char title[64];
+            if (snap->turbo) snprintf(title, sizeof(title), WINDOW_TITLE " - turbo x%.1f", speed);
+            SDL_SetWindowTitle(fe->disp.window, snap->turbo ? title : WINDOW_TITLE);
+            fe->shown_speed = speed;
+        }
+        return presented;
+    }
+
+    return disp_present(&fe->disp, &fe->shown, 0);
+}
+
 int main(int argc, char* argv[]) {
-    if (argc <= 1) {
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+    ScalerFilter filter = SCALER_FILTER_NONE;
+    bool persistence = false;
+    bool turbo = false;
+    unsigned long ipf = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    // Different every run unless given, pass the printed one back to replay.
+    unsigned long long seed = (unsigned long long)time(NULL);
+    char* rom_path = NULL;
+    char* state_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--shift-vy") == 0) quirks.shift_vy = true;
+        else if (strcmp(argv[i], "--load-store-inc-i") == 0) quirks.load_store_inc_i = true;
+        else if (strcmp(argv[i], "--clip-sprites") == 0) quirks.clip_sprites = true;
+        else if (strcmp(argv[i], "--vf-reset") == 0) quirks.vf_reset = true;
+        else if (strcmp(argv[i], "--display-wait") == 0) quirks.display_wait = true;
+        else if (strcmp(argv[i], "--filter=scale2x") == 0) filter = SCALER_FILTER_SCALE2X;
+        else if (strcmp(argv[i], "--filter=scale3x") == 0) filter = SCALER_FILTER_SCALE3X;
+        else if (strcmp(argv[i], "--filter=epx") == 0) filter = SCALER_FILTER_EPX;
+        else if (strcmp(argv[i], "--persistence") == 0) persistence = true;
+        else if (strcmp(argv[i], "--turbo") == 0) turbo = true;
+        else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) ipf = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--state") == 0 && i + 1 < argc) state_path = argv[++i];
+        else if (rom_path == NULL) rom_path = argv[i];
+    }
+
+    if (rom_path == NULL) {
         fprintf(stderr, "[FATAL ERROR] No ROM provided !\n");
-        fprintf(stdout, "[INFO] Usage : ./cvm8_cv my_rom.rom/my_rom.ch8\n");
+        fprintf(stdout, "[INFO] Usage : ./cvm8_cv [--shift-vy] [--load-store-inc-i] [--clip-sprites] [--vf-reset] [--display-wait] [--filter=scale2x|scale3x|epx] [--persistence] [--ipf N] [--seed N] [--turbo] [--state file.state] my_rom.rom/my_rom.ch8\n");
         return EXIT_FAILURE;
     }
 
-    char* rom_path = argv[1];
+    // Big and shared by both threads, not worth a stack frame. Its queue
+    // and buffer indices sit on their own cache lines.
+    Emulation* emu = (Emulation*) aligned_alloc(_Alignof(Emulation), (sizeof(Emulation) + _Alignof(Emulation) - 1) / _Alignof(Emulation) * _Alignof(Emulation));
+    Cvm8* vm = cvm8_create(quirks);
 
-    Emulator chip8_emu;
-    emu_init(&chip8_emu);
+    if (emu == NULL || vm == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Memory Allocation Error !\n");
+        free(emu);
+        if (vm != NULL) cvm8_destroy(vm);
+        return EXIT_FAILURE;
+    }
+
+    if (!cvm8_load_rom_from_file(vm, rom_path)) {
+        free(emu);
+        cvm8_destroy(vm);
+        return EXIT_FAILURE;
+    }
 
-    emu_load_rom_from_file(&chip8_emu, rom_path);
+    cvm8_seed_rng(vm, seed);
+    fprintf(stdout, "[INFO] RNG seed %llu\n", seed);
+    cvm8_set_ipf(vm, (uint32_t)ipf);
+    ipf = cvm8_get_ipf(vm);
 
     SDL_Init(SDL_INIT_EVERYTHING);
 
-    SDL_Window* window = SDL_CreateWindow("CVM8_CV by Yann BOYER", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN);
+    // Runs muted when there's no audio device.
+    AudioPlayer audiopl;
+    emu->vm = vm;
+    emu->audiopl = audiopl_init(&audiopl) ? &audiopl : NULL;
+    emu->trap = CPU_TRAP_NONE;
+    emu->keys_dropped = 0;
+    // Next to the ROM unless given.
+    if (state_path != NULL) snprintf(emu->state_path, sizeof(emu->state_path), "%s", state_path);
+    else snprintf(emu->state_path, sizeof(emu->state_path), "%s.state", rom_path);
+    inq_init(&emu->inq);
+    emu->input_sem = SDL_CreateSemaphore(0);
+    tbuf_init(&emu->tbuf);
+    atomic_init(&emu->is_running, true);
+    atomic_init(&emu->is_idle, false);
+
+    Frontend fe = { .emu = emu, .shown_frame = 0, .shown_speed = 0.0 };
+    re_init(&fe.shown);
 
-    if (window == NULL) {
-        emu_deinit(&chip8_emu);
-        fprintf(stderr, "[FATAL ERROR] Unable to create the window !\n");
+    if (!disp_init(&fe.disp, WINDOW_TITLE, filter, persistence)) {
+        audiopl_deinit(&audiopl);
+        free(emu);
+        cvm8_destroy(vm);
+        SDL_Quit();
         return EXIT_FAILURE;
     }
 
-    SDL_Renderer* renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_SOFTWARE);
+    sched_init(&emu->sched, FRAMES_PER_SECOND, ipf);
+    emu->prev_wake_ns = emu->sched.last_wake_ns;
+    set_turbo(emu, turbo);
+    // Presentation paces itself too, at the same rate whatever turbo does.
+    sched_init(&fe.sched, FRAMES_PER_SECOND, ipf);
 
-    if (renderer == NULL) {
-        emu_deinit(&chip8_emu);
-        SDL_DestroyWindow(window); // Destroy the created window.
-        fprintf(stderr, "[FATAL ERROR] Unable to create the renderer !\n");
+    SDL_Thread* thread = emu->input_sem == NULL ? NULL : SDL_CreateThread(emulation_thread, "cvm8 emulation", emu);
+
+    if (thread == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Unable to start the emulation thread !\n");
+        if (emu->input_sem != NULL) SDL_DestroySemaphore(emu->input_sem);
+        disp_deinit(&fe.disp);
+        audiopl_deinit(&audiopl);
+        free(emu);
+        cvm8_destroy(vm);
         SDL_Quit();
         return EXIT_FAILURE;
     }
 
-    uint8_t div_cycles = 0;
-    bool is_running = true;
-
-    while (is_running) {
+    while (atomic_load(&emu->is_running)) {
         SDL_Event ev;
-        while (SDL_PollEvent(&ev)) {
-            switch (ev.type) {
-                case SDL_QUIT:
-                    is_running = false;
-                    break;
-                case SDL_KEYDOWN:
-                    break;
-                case SDL_KEYUP:
-                    break;
-                default: break;
-            }
-        }
+        while (SDL_PollEvent(&ev)) handle_event(&fe, &ev);
 
-        emu_do_cpu_cycle(&chip8_emu);
-        div_cycles++;
-
-        // Drawing.
-        for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
-            for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
-                SDL_Rect pixel = { x * PIXEL_SCALE_FACTOR, y * PIXEL_SCALE_FACTOR, PIXEL_SCALE_FACTOR, PIXEL_SCALE_FACTOR };
-                if (emu_re_is_pixel_on(&chip8_emu, x, y))
-                    SDL_SetRenderDrawColor(renderer, 255, 255, 255, SDL_ALPHA_OPAQUE);
-                else
-                    SDL_SetRenderDrawColor(renderer, 0, 0, 0, SDL_ALPHA_OPAQUE);
-                SDL_RenderFillRect(renderer, &pixel);
-            }
+        // Read before taking a frame, whatever got published before the
+        // emulation went idle is on screen below.
+        bool emu_idle = atomic_load(&emu->is_idle);
+        if (present_latest(&fe) || !emu_idle) {
+            sched_wait_frame(&fe.sched);
+            continue;
         }
 
-        SDL_RenderPresent(renderer);
-        SDL_RenderClear(renderer); // Prevent slowdowns...
+        // Screen settled, fades included, and nothing comes until a key :
+        // sleep on host events, the emulation thread sends one when it resumes.
+        if (SDL_WaitEvent(&ev)) handle_event(&fe, &ev);
+        sched_skip_frames(&fe.sched, sched_now_ns());
+    }
 
-        if (div_cycles == TIMER_CLOCK_DIVISION) {
-            emu_update_cpu_timers(&chip8_emu);
-            div_cycles = 0;
-        }
+    // Also what makes reading the emulation side safe below.
+    SDL_WaitThread(thread, NULL);
 
-        SDL_Delay(CPU_CLOCK_DELAY);
+    int exit_code = EXIT_SUCCESS;
+    if (emu->trap != CPU_TRAP_NONE) {
+        fprintf(stderr, "[ERROR] %s at 0x%03x !\n", cpu_trap_name(emu->trap), cvm8_get_pc(vm));
+        exit_code = EXIT_FAILURE;
     }
 
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
-    emu_deinit(&chip8_emu);
+    cvm8_print_fusion_report(vm, rom_path);
+    disp_print_stats(&fe.disp);
+    fprintf(stdout, "[INFO] Frames : %llu published, %llu presented, %llu input events dropped\n",
+        (unsigned long long)emu->tbuf.published, (unsigned long long)emu->tbuf.taken, (unsigned long long)(emu->inq.dropped + emu->keys_dropped));
+    sched_print_stats(&emu->sched, "Emulation thread");
+    sched_print_stats(&fe.sched, "Presentation thread");
+
+    SDL_DestroySemaphore(emu->input_sem);
+    disp_deinit(&fe.disp);
+    audiopl_deinit(&audiopl);
+    free(emu);
+    cvm8_destroy(vm);
     SDL_Quit();
 
-    return EXIT_SUCCESS;
+    return exit_code;
 }
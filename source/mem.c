@@ -3,29 +3,78 @@
 */
 #include "mem.h"
 #include <stddef.h>
-#include <stdio.h>
-#include <stdlib.h>
+#include <string.h>
+
+static const uint8_t FONTSET[FONTSET_SIZE] = {
+    0xF0, 0x90, 0x90, 0x90, 0xF0, // 0
+    0x20, 0x60, 0x20, 0x20, 0x70, // 1
+    0xF0, 0x10, 0xF0, 0x80, 0xF0, // 2
+    0xF0, 0x10, 0xF0, 0x10, 0xF0, // 3
+    0x90, 0x90, 0xF0, 0x10, 0x10, // 4
+    0xF0, 0x80, 0xF0, 0x10, 0xF0, // 5
+    0xF0, 0x80, 0xF0, 0x90, 0xF0, // 6
+    0xF0, 0x10, 0x20, 0x40, 0x40, // 7
+    0xF0, 0x90, 0xF0, 0x90, 0xF0, // 8
+    0xF0, 0x90, 0xF0, 0x10, 0xF0, // 9
+    0xF0, 0x90, 0xF0, 0x90, 0x90, // A
+    0xE0, 0x90, 0xE0, 0x90, 0xE0, // B
+    0xF0, 0x80, 0x80, 0x80, 0xF0, // C
+    0xE0, 0x90, 0x90, 0x90, 0xE0, // D
+    0xF0, 0x80, 0xF0, 0x80, 0xF0, // E
+    0xF0, 0x80, 0xF0, 0x80, 0x80, // F
+};
 
 void mem_init(Memory* mem) {
     for (size_t i = 0; i < TOTAL_MEMORY_SIZE; i++) {
         mem->mem[i] = 0;
     }
+
+    // Every slot becomes OP_UNDECODED.
+    memset(mem->decoded_ops, 0, sizeof(mem->decoded_ops));
+
+#ifdef CVM8_JIT
+    memset(mem->code_map, 0, sizeof(mem->code_map));
+    mem->code_dirty = false;
+    mem->code_dirty_lo = 0;
+    mem->code_dirty_hi = 0;
+#endif
 }
 
+// The CPU handlers range check up front and raise a trap, out of range
+// accesses never reach these two, they just read 0 / get dropped.
 uint8_t mem_read(Memory* mem, uint16_t addr) {
-    if (addr > TOTAL_MEMORY_SIZE - 1) {
-        fprintf(stderr, "[FATAL ERROR] Memory READ command is out of range !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
-    }
+    if (addr > TOTAL_MEMORY_SIZE - 1) return 0;
 
     return mem->mem[addr];
 }
 
 void mem_write(Memory* mem, uint16_t addr, uint8_t value) {
-    if (addr > TOTAL_MEMORY_SIZE - 1) {
-        fprintf(stderr, "[FATAL ERROR] Memory WRITE command is out of range !\n");
-        exit(EXIT_FAILURE);
-    }
+    if (addr > TOTAL_MEMORY_SIZE - 1) return;
 
     mem->mem[addr] = value;
+    // Even or odd, addr >> 1 is the slot of the instruction holding this byte,
+    // the two before it may be fused ops reading it as their tail.
+    uint16_t slot = addr >> 1;
+    for (uint16_t i = slot >= 2 ? slot - 2 : 0; i <= slot; i++) {
+        mem->decoded_ops[i].handler = OP_UNDECODED;
+    }
+
+#ifdef CVM8_JIT
+    if (mem->code_map[addr >> 1]) {
+        if (!mem->code_dirty || addr < mem->code_dirty_lo) mem->code_dirty_lo = addr;
+        if (!mem->code_dirty || addr > mem->code_dirty_hi) mem->code_dirty_hi = addr;
+        mem->code_dirty = true;
+    }
+#endif
+}
+
+void mem_load_rom(Memory* mem, const uint8_t* rom_buf, size_t rom_size) {
+    // Load FONTSET before anything else.
+    for (uint8_t i = 0; i < FONTSET_SIZE; i++) {
+        mem_write(mem, i, FONTSET[i]);
+    }
+
+    for (size_t idx = 0; idx < rom_size; idx++) {
+        mem_write(mem, idx + CPU_INTERNAL_PROGRAM_COUNTER_START, rom_buf[idx]);
+    }
 }
@@ -0,0 +1,92 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "phosphor.h"
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define BYTE_BROADCAST 0x0101010101010101ULL
+
+void phos_init(Phosphor* phos, uint8_t decay) {
+    memset(phos->intensity, 0, sizeof(phos->intensity));
+    phos->decay = decay;
+}
+
+#if defined(__AVX2__)
+
+// 32 pixels per step, pixel x + i being bit 31 - i of `bits`.
+static bool phos_update_span(uint8_t* intensity, uint32_t bits, __m256i decay) {
+    const __m256i lane_bits = _mm256_set1_epi64x((int64_t)0x0102040810204080ULL);
+    __m256i bytes = _mm256_set_epi64x((int64_t)((bits & 0xFF) * BYTE_BROADCAST), (int64_t)((bits >> 8 & 0xFF) * BYTE_BROADCAST),
+        (int64_t)((bits >> 16 & 0xFF) * BYTE_BROADCAST), (int64_t)((bits >> 24) * BYTE_BROADCAST));
+    __m256i lit = _mm256_cmpeq_epi8(_mm256_and_si256(bytes, lane_bits), lane_bits);
+
+    __m256i old = _mm256_loadu_si256((const __m256i*)intensity);
+    __m256i zero = _mm256_setzero_si256();
+    __m256i lo = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpacklo_epi8(old, zero), decay), 8);
+    __m256i hi = _mm256_srli_epi16(_mm256_mullo_epi16(_mm256_unpackhi_epi8(old, zero), decay), 8);
+    __m256i faded = _mm256_or_si256(_mm256_packus_epi16(lo, hi), lit);
+
+    _mm256_storeu_si256((__m256i*)intensity, faded);
+    return _mm256_movemask_epi8(_mm256_cmpeq_epi8(old, faded)) != -1;
+}
+
+#define PHOS_SPAN 32
+
+#elif defined(__SSE2__)
+
+// 16 pixels per step, pixel x + i being bit 15 - i of `bits`.
+static bool phos_update_span(uint8_t* intensity, uint32_t bits, __m128i decay) {
+    const __m128i lane_bits = _mm_set1_epi64x((int64_t)0x0102040810204080ULL);
+    __m128i bytes = _mm_set_epi64x((int64_t)((bits & 0xFF) * BYTE_BROADCAST), (int64_t)((bits >> 8 & 0xFF) * BYTE_BROADCAST));
+    __m128i lit = _mm_cmpeq_epi8(_mm_and_si128(bytes, lane_bits), lane_bits);
+
+    __m128i old = _mm_loadu_si128((const __m128i*)intensity);
+    __m128i zero = _mm_setzero_si128();
+    __m128i lo = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpacklo_epi8(old, zero), decay), 8);
+    __m128i hi = _mm_srli_epi16(_mm_mullo_epi16(_mm_unpackhi_epi8(old, zero), decay), 8);
+    __m128i faded = _mm_or_si128(_mm_packus_epi16(lo, hi), lit);
+
+    _mm_storeu_si128((__m128i*)intensity, faded);
+    return _mm_movemask_epi8(_mm_cmpeq_epi8(old, faded)) != 0xFFFF;
+}
+
+#define PHOS_SPAN 16
+
+#endif
+
+uint32_t phos_update(Phosphor* phos, const RenderEngine* re) {
+    uint32_t changed_rows = 0;
+
+#ifdef PHOS_SPAN
+#if defined(__AVX2__)
+    __m256i decay = _mm256_set1_epi16(phos->decay);
+#else
+    __m128i decay = _mm_set1_epi16(phos->decay);
+#endif
+    for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        bool changed = false;
+        for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x += PHOS_SPAN) {
+            uint32_t bits = (uint32_t)(re->rows[y] >> (64 - PHOS_SPAN - x)) & (uint32_t)((1ULL << PHOS_SPAN) - 1);
+            changed |= phos_update_span(&phos->intensity[y][x], bits, decay);
+        }
+        changed_rows |= (uint32_t)changed << y;
+    }
+#else
+    for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        bool changed = false;
+        for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+            uint8_t old = phos->intensity[y][x];
+            uint8_t faded = (re->rows[y] >> (63 - x)) & 1 ? PHOSPHOR_FULL_INTENSITY : (old * phos->decay) >> 8;
+            phos->intensity[y][x] = faded;
+            changed |= faded != old;
+        }
+        changed_rows |= (uint32_t)changed << y;
+    }
+#endif
+
+    return changed_rows;
+}
@@ -3,38 +3,39 @@
 */
 #include "render_engine.h"
 #include "consts.h"
-#include <stdio.h>
-#include <stdlib.h>
-#include <stddef.h>
+#include <string.h>
 
 void re_init(RenderEngine* re) {
-    for (size_t i = 0; i < RENDER_TABLE_SIZE; i++) {
-        re->render_table[i] = PIXEL_OFF;
-    }
+    re->generation = 0;
+    re_clear(re);
 }
 
-bool re_is_pixel_on(RenderEngine* re, uint8_t x, uint8_t y) {
-    if (x > CHIP8_SCREEN_WIDTH || y > CHIP8_SCREEN_HEIGHT) {
-        fprintf(stderr, "[FATAL ERROR] Invalid coordinates !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
-    }
+// Off-screen pixels read as off.
+bool re_is_pixel_on(const RenderEngine* re, uint8_t x, uint8_t y) {
+    if (x >= CHIP8_SCREEN_WIDTH || y >= CHIP8_SCREEN_HEIGHT) return false;
 
-    return re->render_table[y * CHIP8_SCREEN_WIDTH + x] == PIXEL_ON;
+    return (re->rows[y] >> (63 - x)) & 1;
 }
 
+// Off-screen pixels are ignored.
 void re_change_pixel_state_to(RenderEngine* re, uint8_t x, uint8_t y, PixelState new_state) {
-    if (x > CHIP8_SCREEN_WIDTH || y > CHIP8_SCREEN_HEIGHT) {
-        fprintf(stderr, "[FATAL ERROR] Invalid coordinates !\n");
-        exit(EXIT_FAILURE); // Ugly, don't care.
-    }
+    if (x >= CHIP8_SCREEN_WIDTH || y >= CHIP8_SCREEN_HEIGHT) return;
 
-    re->render_table[y * CHIP8_SCREEN_WIDTH + x] = new_state;
+    uint64_t bit = (uint64_t)1 << (63 - x);
+    uint64_t old_row = re->rows[y];
+    if (new_state == PIXEL_ON) re->rows[y] |= bit;
+    else re->rows[y] &= ~bit;
+
+    re->generation += re->rows[y] != old_row;
 }
 
 void re_clear(RenderEngine* re) {
-    for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
-        for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
-            re_change_pixel_state_to(re, x, y, PIXEL_OFF);
-        }
-    }
+    memset(re->rows, 0, sizeof(re->rows));
+    re->generation++;
+}
+
+uint32_t re_diff_rows(const RenderEngine* a, const RenderEngine* b) {
+    uint32_t diff = 0;
+    for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) diff |= (uint32_t)(a->rows[y] != b->rows[y]) << y;
+    return diff;
 }
@@ -0,0 +1,276 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "scaler.h"
+#include "consts.h"
+#include <string.h>
+
+#if defined(__AVX2__) || defined(__SSE2__)
+#include <immintrin.h>
+#endif
+
+#define SCALER_MAX_FACTOR 3
+#define TOP_BIT ((uint64_t)1 << 63)
+
+uint8_t scaler_filter_factor(ScalerFilter filter) {
+    switch (filter) {
+        case SCALER_FILTER_SCALE2X:
+        case SCALER_FILTER_EPX: return 2;
+        case SCALER_FILTER_SCALE3X: return 3;
+        default: return 1;
+    }
+}
+
+bool scaler_is_scale_valid(ScalerFilter filter, uint8_t scale) {
+    return scale != 0 && scale % scaler_filter_factor(filter) == 0;
+}
+
+// Filters work on whole rows, one bit per pixel, x = 0 being the top bit.
+// Out of screen neighbours repeat the edge pixel.
+static inline uint64_t left_of(uint64_t row) {
+    return row >> 1 | (row & TOP_BIT);
+}
+
+static inline uint64_t right_of(uint64_t row) {
+    return row << 1 | (row & 1);
+}
+
+static inline uint64_t select_bits(uint64_t cond, uint64_t if_set, uint64_t if_clear) {
+    return (cond & if_set) | (~cond & if_clear);
+}
+
+// One 64 pixels wide bit row to colors, no scaling.
+static void expand_bits(uint64_t bits, uint32_t on_color, uint32_t off_color, uint32_t* dst) {
+#if defined(__AVX2__)
+    // Each lane tests its own bit of the broadcasted byte.
+    const __m256i lane_bits = _mm256_set_epi32(1, 2, 4, 8, 16, 32, 64, 128);
+    const __m256i off = _mm256_set1_epi32((int)off_color);
+    const __m256i diff = _mm256_set1_epi32((int)(on_color ^ off_color));
+    for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x += 8) {
+        __m256i byte = _mm256_set1_epi32((int)(bits >> (56 - x) & 0xFF));
+        __m256i mask = _mm256_cmpeq_epi32(_mm256_and_si256(byte, lane_bits), lane_bits);
+        _mm256_storeu_si256((__m256i*)(dst + x), _mm256_xor_si256(off, _mm256_and_si256(mask, diff)));
+    }
+#elif defined(__SSE2__)
+    const __m128i lane_bits = _mm_set_epi32(1, 2, 4, 8);
+    const __m128i off = _mm_set1_epi32((int)off_color);
+    const __m128i diff = _mm_set1_epi32((int)(on_color ^ off_color));
+    for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x += 4) {
+        __m128i nibble = _mm_set1_epi32((int)(bits >> (60 - x) & 0xF));
+        __m128i mask = _mm_cmpeq_epi32(_mm_and_si128(nibble, lane_bits), lane_bits);
+        _mm_storeu_si128((__m128i*)(dst + x), _mm_xor_si128(off, _mm_and_si128(mask, diff)));
+    }
+#else
+    for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+        dst[x] = (bits >> (63 - x)) & 1 ? on_color : off_color;
+    }
+#endif
+}
+
+// Bit i of x moves to bit 2 * i, the others are cleared.
+static inline uint64_t spread_by_2(uint32_t x) {
+    uint64_t v = x;
+    v = (v | v << 16) & 0x0000FFFF0000FFFFULL;
+    v = (v | v << 8) & 0x00FF00FF00FF00FFULL;
+    v = (v | v << 4) & 0x0F0F0F0F0F0F0F0FULL;
+    v = (v | v << 2) & 0x3333333333333333ULL;
+    v = (v | v << 1) & 0x5555555555555555ULL;
+    return v;
+}
+
+// Bit i of the low 21 bits of x moves to bit 3 * i.
+static inline uint64_t spread_by_3(uint32_t x) {
+    uint64_t v = x & 0x1FFFFF;
+    v = (v | v << 32) & 0x001F00000000FFFFULL;
+    v = (v | v << 16) & 0x001F0000FF0000FFULL;
+    v = (v | v << 8) & 0x100F00F00F00F00FULL;
+    v = (v | v << 4) & 0x10C30C30C30C30C3ULL;
+    v = (v | v << 2) & 0x1249249249249249ULL;
+    return v;
+}
+
+// Bit lines have column 0 at the top bit of words[0], like framebuffer rows.
+// ORs the `count` low bits of `bits`, most significant first, at column col.
+static inline void put_bits(uint64_t* words, size_t col, uint64_t bits, uint8_t count) {
+    uint64_t top = bits << (64 - count);
+    uint8_t offset = col % 64;
+    words[col / 64] |= top >> offset;
+    if (offset + count > 64) words[col / 64 + 1] |= top << (64 - offset);
+}
+
+// Leading zeros of a non-zero word, one instruction where the compiler
+// has a builtin for it, a binary search anywhere else.
+static inline uint8_t clz64(uint64_t bits) {
+#if defined(__GNUC__) || defined(__clang__)
+    return (uint8_t)__builtin_clzll(bits);
+#else
+    uint8_t n = 0;
+    for (uint8_t shift = 32; shift > 0; shift /= 2) {
+        if (bits >> (64 - shift) == 0) {
+            n += shift;
+            bits <<= shift;
+        }
+    }
+    return n;
+#endif
+}
+
+// Sets columns [col, col + count).
+static inline void set_bit_run(uint64_t* words, size_t col, uint8_t count) {
+    while (count > 0) {
+        uint8_t offset = col % 64;
+        uint8_t n = count < 64 - offset ? count : 64 - offset;
+        put_bits(words, col, n == 64 ? UINT64_MAX : ((uint64_t)1 << n) - 1, n);
+        col += n;
+        count -= n;
+    }
+}
+
+// Pixel x of plane j to column x * plane_count + j, branch free.
+static void interleave_planes(const uint64_t* planes, uint8_t plane_count, uint64_t* words) {
+    switch (plane_count) {
+        case 1:
+            words[0] = planes[0];
+            break;
+        case 2:
+            for (uint8_t half = 0; half < 2; half++) {
+                uint8_t shift = half == 0 ? 32 : 0;
+                words[half] = spread_by_2((uint32_t)(planes[0] >> shift)) << 1 | spread_by_2((uint32_t)(planes[1] >> shift));
+            }
+            break;
+        default:
+            // 21 pixels make 63 columns, the last chunk is a single pixel.
+            memset(words, 0, SCALER_MAX_FACTOR * sizeof(uint64_t));
+            for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x += 21) {
+                uint8_t n = CHIP8_SCREEN_WIDTH - x < 21 ? CHIP8_SCREEN_WIDTH - x : 21;
+                uint64_t chunk = spread_by_3((uint32_t)(planes[0] << x >> (64 - n))) << 2
+                    | spread_by_3((uint32_t)(planes[1] << x >> (64 - n))) << 1
+                    | spread_by_3((uint32_t)(planes[2] << x >> (64 - n)));
+                put_bits(words, (size_t)x * 3, chunk, 3 * n);
+            }
+            break;
+    }
+}
+
+// One output line from `plane_count` interleaved bit planes, pixel x of
+// plane j lands at column x * plane_count + j, each `rep` pixels wide.
+// Built as a bit line first, every 64 bits of it then go through expand_bits().
+static void expand_line(const uint64_t* planes, uint8_t plane_count, uint8_t rep, uint32_t on_color, uint32_t off_color, uint32_t* dst) {
+    uint64_t interleaved[SCALER_MAX_FACTOR];
+    // plane_count * rep <= scale words.
+    uint64_t repeated[UINT8_MAX];
+    const uint64_t* words = interleaved;
+    uint16_t word_count = (uint16_t)plane_count * rep;
+
+    interleave_planes(planes, plane_count, interleaved);
+
+    // Odd part of rep a set pixel at a time, most of a CHIP-8 screen is
+    // off, then each doubling spreads every word into two.
+    uint8_t odd_rep = rep;
+    uint16_t count = plane_count;
+    while (odd_rep % 2 == 0) odd_rep /= 2;
+
+    if (odd_rep > 1) {
+        memset(repeated, 0, (size_t)count * odd_rep * sizeof(uint64_t));
+        for (uint8_t w = 0; w < count; w++) {
+            for (uint64_t bits = interleaved[w]; bits != 0;) {
+                uint8_t x = clz64(bits);
+                set_bit_run(repeated, ((size_t)w * 64 + x) * odd_rep, odd_rep);
+                bits &= ~(TOP_BIT >> x);
+            }
+        }
+        words = repeated;
+        count *= odd_rep;
+    }
+
+    for (uint8_t r = odd_rep; r < rep; r *= 2) {
+        // Backwards, repeated[2w] and [2w + 1] only overwrite words already read.
+        for (int w = count - 1; w >= 0; w--) {
+            uint64_t bits = words[w];
+            uint64_t hi = spread_by_2((uint32_t)(bits >> 32)), lo = spread_by_2((uint32_t)bits);
+            repeated[2 * w] = hi << 1 | hi;
+            repeated[2 * w + 1] = lo << 1 | lo;
+        }
+        words = repeated;
+        count *= 2;
+    }
+
+    for (uint16_t w = 0; w < word_count; w++) {
+        expand_bits(words[w], on_color, off_color, dst + (size_t)w * CHIP8_SCREEN_WIDTH);
+    }
+}
+
+// Sub-row planes of framebuffer row y, returns how many sub-rows.
+static uint8_t filter_row(const RenderEngine* re, ScalerFilter filter, uint8_t y, uint64_t planes[SCALER_MAX_FACTOR][SCALER_MAX_FACTOR]) {
+    uint64_t e = re->rows[y];
+
+    if (filter == SCALER_FILTER_NONE) {
+        planes[0][0] = e;
+        return 1;
+    }
+
+    // A B C
+    // D E F
+    // G H I
+    uint64_t b = re->rows[y == 0 ? 0 : y - 1];
+    uint64_t h = re->rows[y == CHIP8_SCREEN_HEIGHT - 1 ? y : y + 1];
+    uint64_t d = left_of(e), f = right_of(e);
+    // Bitwise equality masks.
+    uint64_t d_b = ~(d ^ b), b_f = ~(b ^ f), d_h = ~(d ^ h), h_f = ~(h ^ f);
+    uint64_t top_left = d_b & ~b_f & ~d_h;
+    uint64_t top_right = b_f & ~d_b & ~h_f;
+    uint64_t bottom_left = d_h & ~d_b & ~h_f;
+    uint64_t bottom_right = h_f & ~d_h & ~b_f;
+
+    if (filter != SCALER_FILTER_SCALE3X) {
+        planes[0][0] = select_bits(top_left, d, e);
+        planes[0][1] = select_bits(top_right, f, e);
+        planes[1][0] = select_bits(bottom_left, d, e);
+        planes[1][1] = select_bits(bottom_right, f, e);
+        return 2;
+    }
+
+    uint64_t a = left_of(b), c = right_of(b), g = left_of(h), i = right_of(h);
+    uint64_t e_a = ~(e ^ a), e_c = ~(e ^ c), e_g = ~(e ^ g), e_i = ~(e ^ i);
+
+    planes[0][0] = select_bits(top_left, d, e);
+    planes[0][1] = select_bits((top_left & ~e_c) | (top_right & ~e_a), b, e);
+    planes[0][2] = select_bits(top_right, f, e);
+    planes[1][0] = select_bits((top_left & ~e_g) | (bottom_left & ~e_a), d, e);
+    planes[1][1] = e;
+    planes[1][2] = select_bits((top_right & ~e_i) | (bottom_right & ~e_c), f, e);
+    planes[2][0] = select_bits(bottom_left, d, e);
+    planes[2][1] = select_bits((bottom_left & ~e_i) | (bottom_right & ~e_g), h, e);
+    planes[2][2] = select_bits(bottom_right, f, e);
+    return 3;
+}
+
+bool scaler_scale_rows(const RenderEngine* re, ScalerFilter filter, uint8_t scale, uint32_t on_color, uint32_t off_color,
+    uint8_t first_row, uint8_t last_row, uint32_t* out, size_t pitch) {
+    if (!scaler_is_scale_valid(filter, scale) || first_row > last_row || last_row >= CHIP8_SCREEN_HEIGHT) return false;
+
+    uint8_t factor = scaler_filter_factor(filter);
+    uint8_t rep = scale / factor;
+    size_t line_size = (size_t)CHIP8_SCREEN_WIDTH * scale * sizeof(uint32_t);
+
+    for (uint8_t y = first_row; y <= last_row; y++) {
+        uint64_t planes[SCALER_MAX_FACTOR][SCALER_MAX_FACTOR];
+        uint8_t sub_rows = filter_row(re, filter, y, planes);
+
+        for (uint8_t sub_row = 0; sub_row < sub_rows; sub_row++) {
+            uint32_t* line = out + ((size_t)(y - first_row) * scale + (size_t)sub_row * rep) * pitch;
+            expand_line(planes[sub_row], factor, rep, on_color, off_color, line);
+
+            // Nearest neighbour vertically, the line is still hot in cache.
+            for (uint8_t r = 1; r < rep; r++) {
+                memcpy(line + r * pitch, line, line_size);
+            }
+        }
+    }
+
+    return true;
+}
+
+bool scaler_scale(const RenderEngine* re, ScalerFilter filter, uint8_t scale, uint32_t on_color, uint32_t off_color, uint32_t* out, size_t pitch) {
+    return scaler_scale_rows(re, filter, scale, on_color, off_color, 0, CHIP8_SCREEN_HEIGHT - 1, out, pitch);
+}
@@ -0,0 +1,180 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+// clock_gettime(), clock_nanosleep() and nanosleep() are POSIX, not C.
+#define _POSIX_C_SOURCE 200809L
+
+#include "scheduler.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <time.h>
+
+#define SCHED_NS_PER_SEC 1000000000ULL
+
+uint64_t sched_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * SCHED_NS_PER_SEC + (uint64_t)ts.tv_nsec;
+}
+
+static void sched_sleep_until(uint64_t deadline_ns) {
+#ifdef TIMER_ABSTIME
+    struct timespec ts = { .tv_sec = deadline_ns / SCHED_NS_PER_SEC, .tv_nsec = deadline_ns % SCHED_NS_PER_SEC };
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {}
+#else
+    // No absolute sleep there (macOS), the deadline itself still is.
+    uint64_t now_ns;
+    while ((now_ns = sched_now_ns()) < deadline_ns) {
+        uint64_t left_ns = deadline_ns - now_ns;
+        struct timespec ts = { .tv_sec = left_ns / SCHED_NS_PER_SEC, .tv_nsec = left_ns % SCHED_NS_PER_SEC };
+        nanosleep(&ts, NULL);
+    }
+#endif
+}
+
+// Exact for any fps, no rounding error piling up frame after frame.
+static uint64_t sched_deadline_ns(const FrameScheduler* sched) {
+    return sched->epoch_ns + sched->frame_index * SCHED_NS_PER_SEC / sched->fps;
+}
+
+// Frames emulated per wall clock second over fps, paced or not.
+static void sched_update_speed(FrameScheduler* sched, uint64_t now_ns) {
+    sched->speed_window_frames++;
+
+    uint64_t elapsed_ns = now_ns - sched->speed_window_ns;
+    if (elapsed_ns < SCHED_NS_PER_SEC) return;
+
+    sched->speed = (double)sched->speed_window_frames * SCHED_NS_PER_SEC / ((double)elapsed_ns * sched->fps);
+    sched->speed_updates++;
+    sched->speed_window_ns = now_ns;
+    sched->speed_window_frames = 0;
+}
+
+static void sched_restart(FrameScheduler* sched, uint64_t now_ns) {
+    sched->epoch_ns = now_ns;
+    sched->frame_index = 0;
+    sched->last_wake_ns = now_ns;
+    sched->busy_start_ns = now_ns;
+}
+
+void sched_init(FrameScheduler* sched, uint32_t fps, uint32_t ipf) {
+    sched->ipf = ipf;
+    sched->fps = fps;
+    sched->turbo = false;
+    sched_restart(sched, sched_now_ns());
+    sched->speed = 0.0;
+    sched->speed_updates = 0;
+    sched->speed_window_ns = sched->epoch_ns;
+    sched->speed_window_frames = 0;
+    sched->turbo_frames = 0;
+    sched->turbo_ns = 0;
+    sched->frames = 0;
+    sched->missed_deadlines = 0;
+    sched->resyncs = 0;
+    sched->lateness_min_ns = INT64_MAX;
+    sched->lateness_max_ns = 0;
+    sched->lateness_mean_ns = 0.0;
+    sched->lateness_m2 = 0.0;
+    sched->interval_max_dev_ns = 0;
+    sched->busy_total_ns = 0;
+    sched->busy_max_ns = 0;
+}
+
+void sched_wait_frame(FrameScheduler* sched) {
+    uint64_t period_ns = SCHED_NS_PER_SEC / sched->fps;
+
+    if (sched->turbo) {
+        uint64_t now_ns = sched_now_ns();
+        sched->turbo_frames++;
+        sched->turbo_ns += now_ns - sched->last_wake_ns;
+        sched->last_wake_ns = now_ns;
+        sched_update_speed(sched, now_ns);
+        return;
+    }
+
+    sched->frame_index++;
+    uint64_t deadline_ns = sched_deadline_ns(sched);
+    uint64_t now_ns = sched_now_ns();
+    uint64_t busy_ns = now_ns - sched->busy_start_ns;
+
+    if (now_ns >= deadline_ns) {
+        sched->missed_deadlines++;
+
+        // Stalled (debugger, suspended machine...), start over from now.
+        if (now_ns - deadline_ns > SCHED_MAX_LAG_FRAMES * period_ns) {
+            sched_restart(sched, now_ns);
+            sched->resyncs++;
+            deadline_ns = now_ns;
+        }
+    } else {
+        sched_sleep_until(deadline_ns);
+    }
+
+    uint64_t wake_ns = sched_now_ns();
+    int64_t lateness_ns = (int64_t)(wake_ns - deadline_ns);
+    uint64_t interval_ns = wake_ns - sched->last_wake_ns;
+    uint64_t interval_dev_ns = interval_ns > period_ns ? interval_ns - period_ns : period_ns - interval_ns;
+    sched->last_wake_ns = wake_ns;
+    sched->busy_start_ns = wake_ns;
+
+    sched->frames++;
+    if (lateness_ns < sched->lateness_min_ns) sched->lateness_min_ns = lateness_ns;
+    if (lateness_ns > sched->lateness_max_ns) sched->lateness_max_ns = lateness_ns;
+    double delta = lateness_ns - sched->lateness_mean_ns;
+    sched->lateness_mean_ns += delta / sched->frames;
+    sched->lateness_m2 += delta * (lateness_ns - sched->lateness_mean_ns);
+    if (interval_dev_ns > sched->interval_max_dev_ns) sched->interval_max_dev_ns = interval_dev_ns;
+    sched->busy_total_ns += busy_ns;
+    if (busy_ns > sched->busy_max_ns) sched->busy_max_ns = busy_ns;
+
+    sched_update_speed(sched, wake_ns);
+}
+
+uint64_t sched_skip_frames(FrameScheduler* sched, uint64_t until_ns) {
+    if (sched->turbo || until_ns < sched->epoch_ns) return 0;
+
+    // Last deadline at or before until_ns.
+    uint64_t index = (until_ns - sched->epoch_ns) * sched->fps / SCHED_NS_PER_SEC;
+    if (index <= sched->frame_index) return 0;
+
+    uint64_t skipped = index - sched->frame_index;
+    sched->frame_index = index;
+    sched->last_wake_ns = sched_deadline_ns(sched);
+    sched->busy_start_ns = sched_now_ns();
+    sched->speed_window_frames += skipped;
+    return skipped;
+}
+
+void sched_set_turbo(FrameScheduler* sched, bool turbo) {
+    if (sched->turbo == turbo) return;
+
+    // Back to pacing, the deadlines start over from now rather than
+    // sleeping off (or catching up) whatever turbo did.
+    sched->turbo = turbo;
+    uint64_t now_ns = sched_now_ns();
+    if (turbo) sched->last_wake_ns = now_ns;
+    else sched_restart(sched, now_ns);
+}
+
+double sched_lateness_stddev_ns(const FrameScheduler* sched) {
+    return sched->frames < 2 ? 0.0 : sqrt(sched->lateness_m2 / (sched->frames - 1));
+}
+
+void sched_print_stats(const FrameScheduler* sched, const char* name) {
+    if (sched->turbo_frames > 0 && sched->turbo_ns > 0) {
+        fprintf(stdout, "[INFO] %s : %llu turbo frames at x%.1f real time\n", name, (unsigned long long)sched->turbo_frames,
+            (double)sched->turbo_frames * SCHED_NS_PER_SEC / ((double)sched->turbo_ns * sched->fps));
+    }
+
+    if (sched->frames == 0) return;
+
+    fprintf(stdout, "[INFO] %s : %llu frames at %u Hz, %u instructions per frame, %llu missed deadlines, %llu resyncs\n",
+        name, (unsigned long long)sched->frames, sched->fps, sched->ipf, (unsigned long long)sched->missed_deadlines, (unsigned long long)sched->resyncs);
+    fprintf(stdout, "[INFO] %s : lateness min %.1f us, mean %.1f us, stddev %.1f us, max %.1f us, worst period error %.1f us\n",
+        name, sched->lateness_min_ns / 1000.0, sched->lateness_mean_ns / 1000.0, sched_lateness_stddev_ns(sched) / 1000.0,
+        sched->lateness_max_ns / 1000.0, sched->interval_max_dev_ns / 1000.0);
+    fprintf(stdout, "[INFO] %s : busy mean %.1f us, max %.1f us, %.1f%% of the frame period\n",
+        name, (double)sched->busy_total_ns / sched->frames / 1000.0, sched->busy_max_ns / 1000.0,
+        100.0 * sched->busy_total_ns * sched->fps / ((double)sched->frames * SCHED_NS_PER_SEC));
+}
@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "sound.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#define SOUND_BASE_RATE 4000.0
+#define SOUND_PHASE_SHIFT 25 // 32 bits of phase, 7 of them index the 128 bits.
+
+void snd_init_state(SoundState* st) {
+    memset(st->pattern, SOUND_DEFAULT_PATTERN_BYTE, sizeof(st->pattern));
+    st->pitch = SOUND_DEFAULT_PITCH;
+    st->on = false;
+}
+
+static uint32_t snd_step(uint8_t pitch, uint32_t device_rate) {
+    double rate = SOUND_BASE_RATE * pow(2.0, (pitch - 64) / 48.0);
+    return (uint32_t)(rate / device_rate * (double)(1u << SOUND_PHASE_SHIFT));
+}
+
+void snd_voice_init(SoundVoice* voice, uint32_t device_rate) {
+    voice->device_rate = device_rate;
+    voice->phase = 0;
+    voice->step_pitch = SOUND_DEFAULT_PITCH;
+    voice->step = snd_step(SOUND_DEFAULT_PITCH, device_rate);
+}
+
+// Pattern bit i is bit 31 - (i & 31) of big endian word i >> 5.
+static inline uint32_t snd_pattern_word(const uint8_t* pattern, uint8_t w) {
+    const uint8_t* b = pattern + 4 * w;
+    return (uint32_t)b[0] << 24 | (uint32_t)b[1] << 16 | (uint32_t)b[2] << 8 | b[3];
+}
+
+void snd_render(SoundVoice* voice, const SoundState* st, int16_t amplitude, int16_t* out, uint32_t count) {
+    if (st->pitch != voice->step_pitch) {
+        voice->step = snd_step(st->pitch, voice->device_rate);
+        voice->step_pitch = st->pitch;
+    }
+
+    uint32_t phase = voice->phase;
+    uint32_t step = voice->step;
+    voice->phase = phase + step * count;
+
+    if (!st->on) {
+        memset(out, 0, count * sizeof(int16_t));
+        return;
+    }
+
+    uint32_t words[4];
+    for (uint8_t w = 0; w < 4; w++) words[w] = snd_pattern_word(st->pattern, w);
+
+    uint32_t i = 0;
+#if defined(__AVX2__)
+    // 8 samples per step : lane k plays bit (phase + k * step) >> 25, its
+    // word is picked with a permute and the bit with a variable shift.
+    const __m256i pattern = _mm256_setr_epi32(words[0], words[1], words[2], words[3], words[0], words[1], words[2], words[3]);
+    const __m256i lane_steps = _mm256_mullo_epi32(_mm256_set1_epi32((int)step), _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+    const __m256i block_step = _mm256_set1_epi32((int)(step * 8));
+    const __m256i high = _mm256_set1_epi32(amplitude);
+    const __m256i low = _mm256_set1_epi32(-amplitude);
+    const __m256i bit_mask = _mm256_set1_epi32(31);
+    __m256i phases = _mm256_add_epi32(_mm256_set1_epi32((int)phase), lane_steps);
+
+    for (; i + 8 <= count; i += 8) {
+        __m256i index = _mm256_srli_epi32(phases, SOUND_PHASE_SHIFT);
+        __m256i word = _mm256_permutevar8x32_epi32(pattern, _mm256_srli_epi32(index, 5));
+        __m256i shift = _mm256_sub_epi32(bit_mask, _mm256_and_si256(index, bit_mask));
+        __m256i bit = _mm256_and_si256(_mm256_srlv_epi32(word, shift), _mm256_set1_epi32(1));
+        __m256i samples = _mm256_blendv_epi8(low, high, _mm256_sub_epi32(_mm256_setzero_si256(), bit));
+        // Packing works per 128 bit lane, gather both halves back in order.
+        __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(samples, samples), 0x08);
+        _mm_storeu_si128((__m128i*)(out + i), _mm256_castsi256_si128(packed));
+        phases = _mm256_add_epi32(phases, block_step);
+    }
+    phase += step * i;
+#endif
+
+    for (; i < count; i++) {
+        uint32_t index = phase >> SOUND_PHASE_SHIFT;
+        out[i] = (words[index >> 5] >> (31 - (index & 31)) & 1) != 0 ? amplitude : (int16_t)-amplitude;
+        phase += step;
+    }
+}
@@ -0,0 +1,38 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+#include "triple_buffer.h"
+#include <string.h>
+
+void tbuf_init(TripleBuffer* tbuf) {
+    memset(tbuf->slots, 0, sizeof(tbuf->slots));
+    for (uint8_t i = 0; i < 3; i++) re_init(&tbuf->slots[i].fb);
+    tbuf->front = 0;
+    atomic_init(&tbuf->middle, 1);
+    tbuf->back = 2;
+    tbuf->published = 0;
+    tbuf->taken = 0;
+}
+
+FrameSnapshot* tbuf_back(TripleBuffer* tbuf) {
+    return &tbuf->slots[tbuf->back];
+}
+
+// Release so the slot contents are visible before its index, acquire to
+// get the slot the reader is done with.
+void tbuf_publish(TripleBuffer* tbuf) {
+    tbuf->back = atomic_exchange_explicit(&tbuf->middle, tbuf->back | TBUF_FRESH, memory_order_acq_rel) & 3;
+    tbuf->published++;
+}
+
+bool tbuf_take(TripleBuffer* tbuf) {
+    if ((atomic_load_explicit(&tbuf->middle, memory_order_relaxed) & TBUF_FRESH) == 0) return false;
+
+    tbuf->front = atomic_exchange_explicit(&tbuf->middle, tbuf->front, memory_order_acq_rel) & 3;
+    tbuf->taken++;
+    return true;
+}
+
+const FrameSnapshot* tbuf_front(const TripleBuffer* tbuf) {
+    return &tbuf->slots[tbuf->front];
+}
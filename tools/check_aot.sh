@@ -0,0 +1,46 @@
+#!/bin/sh
+#    Copyright (c) 2026 - Yann BOYER
+#
+# check_aot.sh : builds cvm8_headless once plain and once per ROM with its
+# cvm8_aot output built in, then checks both give the same screen hash and
+# retire the same instruction count.
+# Usage : ./tools/check_aot.sh [build_dir] [rom...], roms/* by default.
+set -eu
+
+SOURCE_DIR=$(cd "$(dirname "$0")/.." && pwd)
+BUILD_DIR=${1:-"${TMPDIR:-/tmp}/cvm8_aot_check"}
+[ $# -gt 0 ] && shift
+[ $# -eq 0 ] && set -- "$SOURCE_DIR"/roms/*
+
+cmake -S "$SOURCE_DIR" -B "$BUILD_DIR/plain" -DBUILD_SDL_FRONTEND=OFF -DCVM8_AOT_SOURCE= > /dev/null
+cmake --build "$BUILD_DIR/plain" > /dev/null
+
+# Summary and instruction count lines, the fused/idle split may differ.
+run() {
+    "$1" --frames 600 $2 "$3" | sed -n -e '1p' -e 's/.*: [0-9]* \/ \([0-9]*\) instructions covered.*/\1 instructions/p'
+}
+
+failed=0
+for rom in "$@"; do
+    aot_c="$BUILD_DIR/$(basename "$rom")_aot.c"
+    "$BUILD_DIR/plain/cvm8_aot" "$rom" "$aot_c" > /dev/null
+
+    cmake -S "$SOURCE_DIR" -B "$BUILD_DIR/aot" -DBUILD_SDL_FRONTEND=OFF -DCVM8_AOT_SOURCE="$aot_c" > /dev/null
+    cmake --build "$BUILD_DIR/aot" > /dev/null
+
+    for ipf in 1 9 100; do
+        expected=$(run "$BUILD_DIR/plain/cvm8_headless" "--ipf $ipf" "$rom")
+        actual=$(run "$BUILD_DIR/aot/cvm8_headless" "--ipf $ipf" "$rom")
+
+        if [ "$expected" != "$actual" ]; then
+            echo "[ERROR] $rom : AOT and interpreter differ at $ipf instructions per frame !"
+            echo "$expected"
+            echo "$actual"
+            failed=1
+        else
+            echo "[INFO] $rom : AOT matches the interpreter at $ipf instructions per frame"
+        fi
+    done
+done
+
+exit $failed
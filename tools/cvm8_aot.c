@@ -0,0 +1,376 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+// cvm8_aot : translates a ROM into a C file implementing aot_run_cycles()
+// (see aot.h), build it in with -DCVM8_AOT_SOURCE=path/to/output.c.
+// tools/check_aot.sh checks its output against the interpreter.
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "consts.h"
+#include "decoder.h"
+#include "mem.h"
+
+#define AOT_MAX_BLOCK_OPS 64
+
+typedef enum {
+    AOT_END_FALLTHROUGH, // Block cap or next op can't be compiled.
+    AOT_END_JUMP,
+    AOT_END_SKIP,
+    AOT_END_CALL,
+    AOT_END_DYNAMIC, // RET & JP V0, target only known at runtime.
+    AOT_END_MEM_WRITE, // Fx33/Fx55, might have rewritten the code after it.
+} AotBlockEnd;
+
+typedef struct {
+    uint16_t op_count; // Instructions retired by the block, terminator included.
+    uint16_t len; // Bytes covered.
+    uint8_t end; // AotBlockEnd.
+} AotBlock;
+
+static bool is_leader[TOTAL_MEMORY_SIZE];
+static AotBlock blocks[TOTAL_MEMORY_SIZE];
+static uint16_t worklist[TOTAL_MEMORY_SIZE];
+static size_t worklist_len = 0;
+
+static DecodedOp aot_decode_at(Memory* mem, uint16_t addr) {
+    return decoder_decode_op(mem->mem[addr] << 8 | mem->mem[addr + 1]);
+}
+
+static bool aot_is_skip(uint8_t handler) {
+    return handler == OP_SE_VX_BYTE || handler == OP_SNE_VX_BYTE || handler == OP_SE_VX_VY
+        || handler == OP_SNE_VX_VY || handler == OP_SKP_VX || handler == OP_SKNP_VX;
+}
+
+static void aot_add_leader(uint16_t addr) {
+    if (addr > TOTAL_MEMORY_SIZE - 2 || is_leader[addr]) return;
+
+    is_leader[addr] = true;
+    worklist[worklist_len++] = addr;
+}
+
+// Walks one block from start, registering every successor it can see.
+static AotBlock aot_scan_block(Memory* mem, uint16_t start) {
+    AotBlock block = { .end = AOT_END_FALLTHROUGH };
+    uint16_t addr = start;
+
+    while (block.op_count < AOT_MAX_BLOCK_OPS && addr <= TOTAL_MEMORY_SIZE - 2) {
+        DecodedOp d_op = aot_decode_at(mem, addr);
+
+        // Left to the interpreter, which also reports them.
+        if (d_op.handler == OP_UNKNOWN || d_op.handler == OP_LD_VX_K) break;
+
+        block.op_count++;
+        addr += 2;
+
+        if (d_op.handler == OP_JP_ADDR) {
+            aot_add_leader(d_op.nnn);
+            block.end = AOT_END_JUMP;
+            break;
+        } else if (d_op.handler == OP_CALL_ADDR) {
+            aot_add_leader(d_op.nnn);
+            aot_add_leader(addr); // Return site.
+            block.end = AOT_END_CALL;
+            break;
+        } else if (aot_is_skip(d_op.handler)) {
+            aot_add_leader(addr);
+            aot_add_leader(addr + 2);
+            block.end = AOT_END_SKIP;
+            break;
+        } else if (d_op.handler == OP_RET || d_op.handler == OP_JP_V0_ADDR) {
+            block.end = AOT_END_DYNAMIC;
+            break;
+        } else if (d_op.handler == OP_LD_B_VX || d_op.handler == OP_LD_MEM_I_VX) {
+            aot_add_leader(addr);
+            block.end = AOT_END_MEM_WRITE;
+            break;
+        }
+    }
+
+    if (block.end == AOT_END_FALLTHROUGH) aot_add_leader(addr);
+
+    block.len = addr - start;
+    return block;
+}
+
+// Same check as the decoder's fusion, the interpreter elides these loops
+// up to the budget, far cheaper than running their block over and over.
+static bool aot_is_idle_loop(Memory* mem, uint16_t addr) {
+    if (addr > TOTAL_MEMORY_SIZE - 2 * FUSED_MAX_OPS) return false;
+
+    DecodedOp ops[FUSED_MAX_OPS];
+    for (uint8_t i = 0; i < FUSED_MAX_OPS; i++) ops[i] = aot_decode_at(mem, addr + 2 * i);
+
+    return decoder_fuse_ops(&ops[0], &ops[1], &ops[2], addr) >= OP_IDLE_FIRST;
+}
+
+static bool aot_has_block(uint16_t addr) {
+    return addr <= TOTAL_MEMORY_SIZE - 2 && is_leader[addr] && blocks[addr].op_count > 0;
+}
+
+static void aot_emit_goto(FILE* out, uint16_t target) {
+    fprintf(out, "    cpu->pc = 0x%03x;\n", target);
+    if (aot_has_block(target)) fprintf(out, "    goto block_%03x;\n", target);
+    else fprintf(out, "    goto dispatch;\n");
+}
+
+// ops_after : instructions of the block after this one, already taken
+// out of the budget, that never run if it parks the PC.
+static void aot_emit_call_interpreter(FILE* out, const DecodedOp* d_op, uint16_t addr, uint16_t ops_after) {
+    fprintf(out, "    cpu->pc = 0x%03x;\n", addr);
+    fprintf(out, "    cpu_execute(cpu, mem, re, &(const DecodedOp){ .op = 0x%04x, .nnn = 0x%03x, .handler = %u, .nn = 0x%02x, .x = %u, .y = %u });\n",
+        d_op->op, d_op->nnn, d_op->handler, d_op->nn, d_op->x, d_op->y);
+    // Inlined ops never trap nor halt, only the interpreted ones need the check.
+    fprintf(out, "    if (cpu->pc == CPU_PARKED_PC) {\n");
+    fprintf(out, "        cpu->retired_ops -= cycles + %u + (cpu->trap != CPU_TRAP_NONE);\n", ops_after);
+    fprintf(out, "        return;\n");
+    fprintf(out, "    }\n");
+}
+
+static void aot_emit_skip(FILE* out, const DecodedOp* d_op, uint16_t addr) {
+    unsigned x = d_op->x;
+    unsigned y = d_op->y;
+
+    switch (d_op->handler) {
+        case OP_SE_VX_BYTE: fprintf(out, "    if (cpu->v_regs[%u] == 0x%02x) {\n", x, d_op->nn); break;
+        case OP_SNE_VX_BYTE: fprintf(out, "    if (cpu->v_regs[%u] != 0x%02x) {\n", x, d_op->nn); break;
+        case OP_SE_VX_VY: fprintf(out, "    if (cpu->v_regs[%u] == cpu->v_regs[%u]) {\n", x, y); break;
+        case OP_SNE_VX_VY: fprintf(out, "    if (cpu->v_regs[%u] != cpu->v_regs[%u]) {\n", x, y); break;
+        case OP_SKP_VX: fprintf(out, "    if ((cpu->keys >> (cpu->v_regs[%u] & 0xF) & 1) != 0) {\n", x); break;
+        default: fprintf(out, "    if ((cpu->keys >> (cpu->v_regs[%u] & 0xF) & 1) == 0) {\n", x); break;
+    }
+
+    aot_emit_goto(out, addr + 4);
+    fprintf(out, "    }\n");
+    aot_emit_goto(out, addr + 2);
+}
+
+// Straight-line ops, mirrors the cpu_op_* handlers of cpu.c.
+static void aot_emit_op(FILE* out, const DecodedOp* d_op, uint16_t addr, uint16_t ops_after) {
+    unsigned x = d_op->x;
+    unsigned y = d_op->y;
+
+    switch (d_op->handler) {
+        case OP_LD_VX_BYTE:
+            fprintf(out, "    cpu->v_regs[%u] = 0x%02x;\n", x, d_op->nn);
+            break;
+        case OP_ADD_VX_BYTE:
+            fprintf(out, "    cpu->v_regs[%u] += 0x%02x;\n", x, d_op->nn);
+            break;
+        case OP_LD_VX_VY:
+            fprintf(out, "    cpu->v_regs[%u] = cpu->v_regs[%u];\n", x, y);
+            break;
+        case OP_OR_VX_VY:
+            fprintf(out, "    cpu->v_regs[%u] |= cpu->v_regs[%u];\n", x, y);
+            break;
+        case OP_AND_VX_VY:
+            fprintf(out, "    cpu->v_regs[%u] &= cpu->v_regs[%u];\n", x, y);
+            break;
+        case OP_XOR_VX_VY:
+            fprintf(out, "    cpu->v_regs[%u] ^= cpu->v_regs[%u];\n", x, y);
+            break;
+        case OP_ADD_VX_VY:
+            fprintf(out, "    r = cpu->v_regs[%u] + cpu->v_regs[%u];\n", x, y);
+            fprintf(out, "    cpu->v_regs[0xF] = r > 0xFF ? 1 : 0;\n");
+            fprintf(out, "    cpu->v_regs[%u] = (uint8_t)(r & 0xFF);\n", x);
+            break;
+        case OP_SUB_VX_VY:
+            fprintf(out, "    cpu->v_regs[0xF] = cpu->v_regs[%u] > cpu->v_regs[%u] ? 1 : 0;\n", x, y);
+            fprintf(out, "    cpu->v_regs[%u] -= cpu->v_regs[%u];\n", x, y);
+            break;
+        case OP_SHR_VX:
+            fprintf(out, "    cpu->v_regs[0xF] = cpu->v_regs[%u] & 0x1;\n", x);
+            fprintf(out, "    cpu->v_regs[%u] >>= 1;\n", x);
+            break;
+        case OP_SUBN_VX_VY:
+            fprintf(out, "    cpu->v_regs[0xF] = cpu->v_regs[%u] > cpu->v_regs[%u] ? 1 : 0;\n", y, x);
+            fprintf(out, "    cpu->v_regs[%u] = cpu->v_regs[%u] - cpu->v_regs[%u];\n", x, y, x);
+            break;
+        case OP_SHL_VX:
+            fprintf(out, "    cpu->v_regs[0xF] = (cpu->v_regs[%u] & 128) >> 7;\n", x);
+            fprintf(out, "    cpu->v_regs[%u] <<= 1;\n", x);
+            break;
+        case OP_LD_I_ADDR:
+            fprintf(out, "    cpu->index_reg = 0x%03x;\n", d_op->nnn);
+            break;
+        case OP_LD_VX_DT:
+            fprintf(out, "    cpu->v_regs[%u] = cpu_delay_timer(cpu);\n", x);
+            break;
+        case OP_LD_DT_VX:
+            fprintf(out, "    cpu->delay_expiry = cpu->timer_ticks + cpu->v_regs[%u];\n", x);
+            break;
+        case OP_LD_ST_VX:
+            fprintf(out, "    cpu->sound_expiry = cpu->timer_ticks + cpu->v_regs[%u];\n", x);
+            break;
+        case OP_ADD_I_VX:
+            fprintf(out, "    cpu->index_reg += cpu->v_regs[%u];\n", x);
+            break;
+        case OP_LD_F_VX:
+            fprintf(out, "    cpu->index_reg = cpu->v_regs[%u] * 5;\n", x);
+            break;
+        default:
+            // CLS, DRW, RND, LD Vx, [I] : not worth inlining, PC is kept exact for them.
+            aot_emit_call_interpreter(out, d_op, addr, ops_after);
+            break;
+    }
+}
+
+static void aot_emit_block(FILE* out, Memory* mem, uint16_t start) {
+    AotBlock* block = &blocks[start];
+
+    fprintf(out, "block_%03x:\n", start);
+    fprintf(out, "    if (cycles < %u || memcmp(&mem->mem[0x%03x], aot_code_%03x, %u) != 0) goto fallback;\n",
+        block->op_count, start, start, block->len);
+    fprintf(out, "    cycles -= %u;\n", block->op_count);
+
+    uint16_t addr = start;
+    for (uint16_t i = 0; i < block->op_count; i++, addr += 2) {
+        DecodedOp d_op = aot_decode_at(mem, addr);
+        uint16_t ops_after = block->op_count - 1 - i;
+
+        if (ops_after > 0 || block->end == AOT_END_FALLTHROUGH) {
+            aot_emit_op(out, &d_op, addr, ops_after);
+            continue;
+        }
+
+        switch (block->end) {
+            case AOT_END_JUMP:
+                aot_emit_goto(out, d_op.nnn);
+                break;
+            case AOT_END_SKIP:
+                aot_emit_skip(out, &d_op, addr);
+                break;
+            case AOT_END_CALL:
+                aot_emit_call_interpreter(out, &d_op, addr, 0);
+                if (aot_has_block(d_op.nnn)) fprintf(out, "    goto block_%03x;\n", d_op.nnn);
+                else fprintf(out, "    goto dispatch;\n");
+                break;
+            case AOT_END_MEM_WRITE:
+                aot_emit_call_interpreter(out, &d_op, addr, 0);
+                // The target block re-checks its bytes.
+                aot_emit_goto(out, addr + 2);
+                break;
+            default:
+                aot_emit_call_interpreter(out, &d_op, addr, 0);
+                fprintf(out, "    goto dispatch;\n");
+                break;
+        }
+    }
+
+    if (block->end == AOT_END_FALLTHROUGH) aot_emit_goto(out, addr);
+    fprintf(out, "\n");
+}
+
+static void aot_emit_file(FILE* out, Memory* mem, const char* rom_path) {
+    fprintf(out, "// Generated by cvm8_aot from %s, do not edit.\n", rom_path);
+    fprintf(out, "#include <stdint.h>\n#include <string.h>\n#include \"aot.h\"\n#include \"cpu.h\"\n#include \"decoder.h\"\n\n");
+
+    // Original bytes of every block, a block only runs while they still match.
+    for (uint16_t addr = 0; addr < TOTAL_MEMORY_SIZE; addr++) {
+        if (!aot_has_block(addr)) continue;
+
+        fprintf(out, "static const uint8_t aot_code_%03x[] = {", addr);
+        for (uint16_t i = 0; i < blocks[addr].len; i++) {
+            fprintf(out, "%s0x%02x", i == 0 ? " " : ", ", mem->mem[addr + i]);
+        }
+        fprintf(out, " };\n");
+    }
+
+    fprintf(out, "\nvoid aot_run_cycles(CPU* cpu, Memory* mem, RenderEngine* re, uint32_t cycles) {\n");
+    fprintf(out, "    uint16_t r; // 8xy4 scratch.\n");
+    fprintf(out, "    (void)r;\n");
+    fprintf(out, "    // Same accounting as the cores, what a trap or a halt cut off comes back off.\n");
+    fprintf(out, "    cpu->retired_ops += cycles;\n\n");
+    fprintf(out, "dispatch:\n");
+    fprintf(out, "    if (cycles == 0) return;\n");
+    fprintf(out, "    switch (cpu->pc) {\n");
+    for (uint16_t addr = 0; addr < TOTAL_MEMORY_SIZE; addr++) {
+        if (aot_has_block(addr)) fprintf(out, "        case 0x%03x: goto block_%03x;\n", addr, addr);
+    }
+    fprintf(out, "        default: goto fallback;\n");
+    fprintf(out, "    }\n\n");
+    fprintf(out, "fallback:\n");
+    fprintf(out, "    // Not discovered, rewritten or out of budget, one step of the interpreter.\n");
+    fprintf(out, "    if (cycles == 0) return;\n");
+    fprintf(out, "    cycles -= cpu_run_fallback(cpu, mem, re, cycles);\n");
+    fprintf(out, "    if (cpu->pc == CPU_PARKED_PC) {\n");
+    fprintf(out, "        cpu->retired_ops -= cycles + (cpu->trap != CPU_TRAP_NONE);\n");
+    fprintf(out, "        return;\n");
+    fprintf(out, "    }\n");
+    fprintf(out, "    goto dispatch;\n\n");
+
+    for (uint16_t addr = 0; addr < TOTAL_MEMORY_SIZE; addr++) {
+        if (aot_has_block(addr)) aot_emit_block(out, mem, addr);
+    }
+
+    fprintf(out, "}\n");
+}
+
+int main(int argc, char* argv[]) {
+    if (argc <= 2) {
+        fprintf(stderr, "[FATAL ERROR] No ROM or output provided !\n");
+        fprintf(stdout, "[INFO] Usage : ./cvm8_aot my_rom.ch8 my_rom_aot.c\n");
+        return EXIT_FAILURE;
+    }
+
+    // Same loading as emu_load_rom_from_file().
+    FILE* rom_file = fopen(argv[1], "rb");
+
+    if (rom_file == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Unable to open the ROM file !\n");
+        return EXIT_FAILURE;
+    }
+
+    fseek(rom_file, 0, SEEK_END);
+    unsigned long rom_buf_size = ftell(rom_file);
+    rewind(rom_file);
+
+    if (rom_buf_size > MAX_ROM_SIZE) {
+        fclose(rom_file);
+        fprintf(stderr, "[FATAL ERROR] Your ROM exceeds the max rom size !\n");
+        return EXIT_FAILURE;
+    }
+
+    uint8_t rom_buf[MAX_ROM_SIZE];
+    size_t read = fread(rom_buf, 1, rom_buf_size, rom_file);
+    fclose(rom_file);
+
+    if (read != rom_buf_size) {
+        fprintf(stderr, "[FATAL ERROR] Unable to read the ROM file !\n");
+        return EXIT_FAILURE;
+    }
+
+    static Memory mem;
+    mem_init(&mem);
+    mem_load_rom(&mem, rom_buf, rom_buf_size);
+
+    aot_add_leader(CPU_INTERNAL_PROGRAM_COUNTER_START);
+    while (worklist_len > 0) {
+        uint16_t addr = worklist[--worklist_len];
+        blocks[addr] = aot_scan_block(&mem, addr);
+    }
+
+    // Their successors got registered all the same, only the loops
+    // themselves go to the interpreter.
+    for (uint16_t addr = 0; addr < TOTAL_MEMORY_SIZE; addr++) {
+        if (is_leader[addr] && aot_is_idle_loop(&mem, addr)) blocks[addr].op_count = 0;
+    }
+
+    FILE* out = fopen(argv[2], "w");
+    if (out == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Unable to open the output file !\n");
+        return EXIT_FAILURE;
+    }
+
+    aot_emit_file(out, &mem, argv[1]);
+    fclose(out);
+
+    size_t block_count = 0;
+    for (uint16_t addr = 0; addr < TOTAL_MEMORY_SIZE; addr++) block_count += aot_has_block(addr);
+    fprintf(stdout, "[INFO] %zu blocks written to %s\n", block_count, argv[2]);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,259 @@
+/*
+    Copyright (c) 2026 - Yann BOYER
+*/
+// Runs a ROM without any window nor audio device, for CI and batch jobs.
+// Prints a summary and, with --dump, the final screen as text.
+// --input replays keypad transitions from a text file, one
+// "<cycle> <key> <1|0>" per line ('#' starts a comment), frame f
+// starting at cycle f * ipf. The same script always gives the same run.
+// --audio renders the sound the frontend would play into a raw mono S16
+// file at HEADLESS_AUDIO_RATE, and its hash into the summary.
+// --load-state resumes from a checkpoint instead of booting (the ROM only
+// names the run then, script lines before its cycle are skipped) and
+// --save-state writes one when the run ends, trap or not.
+// --bench N replays the same frames N times from the same start, without
+// input, audio nor halted frame skipping, and reports the fastest run.
+// roms/bench_drw.ch8 is 31 DRW V0, V1, 15 and a JP back, its ns per cycle
+// is about the cost of one DRW.
+// roms/bench_alu.ch8 loops over ALU ops and a skip, no DRW nor idle loop,
+// what the JIT is for.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "cvm8.h"
+#include "consts.h"
+#include "scheduler.h"
+#include "sound.h"
+
+#define HEADLESS_AUDIO_RATE 48000
+#define HEADLESS_AUDIO_AMPLITUDE 4096
+
+static void count_beep(void* user_data) {
+    (*(uint64_t*)user_data)++;
+}
+
+// Next transition of the script, false at its end.
+static bool read_key_event(FILE* input, unsigned long long* cycle, unsigned* key, unsigned* pressed) {
+    char line[128];
+    while (fgets(line, sizeof(line), input) != NULL) {
+        if (sscanf(line, "%llu %x %u", cycle, key, pressed) == 3) return true;
+    }
+    return false;
+}
+
+static bool run_bench(Cvm8* vm, const char* rom_path, unsigned long runs, unsigned long frames, uint32_t ipf) {
+    Cvm8* start = cvm8_create(QUIRKS_DEFAULT);
+
+    if (start == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Memory Allocation Error !\n");
+        return false;
+    }
+
+    // Brings the quirks along, every run starts from the very same state.
+    cvm8_copy_state(start, vm);
+
+    uint64_t best_ns = UINT64_MAX;
+    uint64_t cycles = 0;
+    CpuTrap trap = CPU_TRAP_NONE;
+
+    for (unsigned long run = 0; run < runs && trap == CPU_TRAP_NONE; run++) {
+        cvm8_copy_state(vm, start);
+        uint64_t start_ns = sched_now_ns();
+
+        for (unsigned long frame = 0; frame < frames && trap == CPU_TRAP_NONE; frame++) trap = cvm8_step(vm, ipf);
+
+        uint64_t elapsed_ns = sched_now_ns() - start_ns;
+        if (elapsed_ns < best_ns) best_ns = elapsed_ns;
+        cycles = cvm8_get_cycle(vm) - cvm8_get_cycle(start);
+    }
+
+    cvm8_destroy(start);
+
+    // A trap cuts the run short, its timing means nothing.
+    if (trap != CPU_TRAP_NONE) {
+        fprintf(stderr, "[ERROR] %s at 0x%03x, no benchmark !\n", cpu_trap_name(trap), cvm8_get_pc(vm));
+        return false;
+    }
+
+    if (best_ns == 0) best_ns = 1;
+    fprintf(stdout, "[INFO] %s : best of %lu runs, %llu cycles in %.3f ms, %.2f Mcycles/s, %.2f ns per cycle\n",
+        rom_path, runs, (unsigned long long)cycles, best_ns / 1e6, cycles * 1e3 / best_ns, (double)best_ns / (cycles > 0 ? cycles : 1));
+    if (cvm8_is_halted(vm)) fprintf(stdout, "[INFO] %s : halted in Fx0A at 0x%03x, the cycles after the halt ran nothing\n", rom_path, cvm8_get_pc(vm));
+
+    return true;
+}
+
+int main(int argc, char* argv[]) {
+    QuirkProfile quirks = QUIRKS_DEFAULT;
+    unsigned long frames = 600;
+    unsigned long ipf = DEFAULT_INSTRUCTIONS_PER_FRAME;
+    // Fixed unless given, headless runs are reproducible by default.
+    unsigned long long seed = 0;
+    bool dump = false;
+    bool realtime = false;
+    unsigned long bench_runs = 0;
+    char* rom_path = NULL;
+    char* input_path = NULL;
+    char* audio_path = NULL;
+    char* load_state_path = NULL;
+    char* save_state_path = NULL;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) frames = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--ipf") == 0 && i + 1 < argc) ipf = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--dump") == 0) dump = true;
+        else if (strcmp(argv[i], "--seed") == 0 && i + 1 < argc) seed = strtoull(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) input_path = argv[++i];
+        else if (strcmp(argv[i], "--audio") == 0 && i + 1 < argc) audio_path = argv[++i];
+        else if (strcmp(argv[i], "--load-state") == 0 && i + 1 < argc) load_state_path = argv[++i];
+        else if (strcmp(argv[i], "--save-state") == 0 && i + 1 < argc) save_state_path = argv[++i];
+        else if (strcmp(argv[i], "--realtime") == 0) realtime = true;
+        else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) bench_runs = strtoul(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "--shift-vy") == 0) quirks.shift_vy = true;
+        else if (strcmp(argv[i], "--load-store-inc-i") == 0) quirks.load_store_inc_i = true;
+        else if (strcmp(argv[i], "--clip-sprites") == 0) quirks.clip_sprites = true;
+        else if (strcmp(argv[i], "--vf-reset") == 0) quirks.vf_reset = true;
+        else if (strcmp(argv[i], "--display-wait") == 0) quirks.display_wait = true;
+        else if (rom_path == NULL) rom_path = argv[i];
+    }
+
+    if (rom_path == NULL) {
+        fprintf(stderr, "[FATAL ERROR] No ROM provided !\n");
+        fprintf(stdout, "[INFO] Usage : ./cvm8_headless [--frames N] [--ipf N] [--seed N] [--dump] [--realtime] [--bench N] [--input keys.txt] [--audio out.raw] [--load-state in.state] [--save-state out.state] [quirk flags] my_rom.ch8\n");
+        return EXIT_FAILURE;
+    }
+
+    uint64_t beeps = 0;
+    Cvm8* vm = cvm8_create(quirks);
+
+    if (vm == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Memory Allocation Error !\n");
+        return EXIT_FAILURE;
+    }
+
+    if (!cvm8_load_rom_from_file(vm, rom_path)) {
+        cvm8_destroy(vm);
+        return EXIT_FAILURE;
+    }
+
+    cvm8_set_beep_callback(vm, count_beep, &beeps);
+    cvm8_seed_rng(vm, seed);
+    cvm8_set_ipf(vm, (uint32_t)ipf);
+
+    // Brings back its own quirks, RNG and ipf, whatever the flags said.
+    if (load_state_path != NULL && !cvm8_load_state(vm, load_state_path)) {
+        cvm8_destroy(vm);
+        return EXIT_FAILURE;
+    }
+    ipf = cvm8_get_ipf(vm);
+
+    if (bench_runs > 0) {
+        bool benched = run_bench(vm, rom_path, bench_runs, frames, (uint32_t)ipf);
+        cvm8_destroy(vm);
+        return benched ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+
+    FILE* input = NULL;
+    if (input_path != NULL && (input = fopen(input_path, "r")) == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Unable to open the input file !\n");
+        cvm8_destroy(vm);
+        return EXIT_FAILURE;
+    }
+
+    FILE* audio = NULL;
+    if (audio_path != NULL && (audio = fopen(audio_path, "wb")) == NULL) {
+        fprintf(stderr, "[FATAL ERROR] Unable to open the audio file !\n");
+        if (input != NULL) fclose(input);
+        cvm8_destroy(vm);
+        return EXIT_FAILURE;
+    }
+
+    // One frame's worth of samples after every frame, same stream as the
+    // frontend's callback at that rate.
+    int16_t samples[HEADLESS_AUDIO_RATE / FRAMES_PER_SECOND];
+    SoundVoice voice;
+    SoundState sound;
+    snd_voice_init(&voice, HEADLESS_AUDIO_RATE);
+    uint64_t audio_hash = 0xCBF29CE484222325ULL;
+    uint64_t sounding_frames = 0;
+
+    // The script is fed frame by frame, the queue only holds so many.
+    unsigned long long key_cycle = 0;
+    unsigned key = 0;
+    unsigned pressed = 0;
+    bool has_key = input != NULL && read_key_event(input, &key_cycle, &key, &pressed);
+    // Already applied before the checkpoint.
+    while (has_key && key_cycle < cvm8_get_cycle(vm)) has_key = read_key_event(input, &key_cycle, &key, &pressed);
+
+    // --realtime paces frames like the SDL frontend does, to measure jitter.
+    FrameScheduler sched;
+    sched_init(&sched, FRAMES_PER_SECOND, ipf);
+
+    // A trap stops the run, the summary still gets printed.
+    CpuTrap trap = CPU_TRAP_NONE;
+    unsigned long frame = 0;
+    for (; frame < frames && trap == CPU_TRAP_NONE; frame++) {
+        uint64_t frame_end = cvm8_get_cycle(vm) + ipf;
+        while (has_key && key_cycle < frame_end && cvm8_queue_key(vm, key_cycle, (uint8_t)key, pressed != 0)) {
+            has_key = read_key_event(input, &key_cycle, &key, &pressed);
+        }
+
+        // No keys will ever come, the remaining frames only move the cycle
+        // and the timers. Audio wants every frame rendered.
+        if (!realtime && audio == NULL && !has_key) {
+            uint32_t left = frames - frame > UINT32_MAX ? UINT32_MAX : (uint32_t)(frames - frame);
+            if (cvm8_skip_halted_frames(vm, left)) {
+                frame += left - 1;
+                continue;
+            }
+        }
+
+        trap = cvm8_step(vm, ipf);
+
+        if (audio != NULL) {
+            cvm8_get_sound(vm, &sound);
+            sounding_frames += sound.on;
+            snd_render(&voice, &sound, HEADLESS_AUDIO_AMPLITUDE, samples, sizeof(samples) / sizeof(samples[0]));
+            for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) audio_hash = (audio_hash ^ (uint16_t)samples[i]) * 0x100000001B3ULL;
+            fwrite(samples, sizeof(samples[0]), sizeof(samples) / sizeof(samples[0]), audio);
+        }
+        if (realtime) sched_wait_frame(&sched);
+    }
+
+    if (trap != CPU_TRAP_NONE) {
+        fprintf(stderr, "[ERROR] %s at 0x%03x, frame %lu !\n", cpu_trap_name(trap), cvm8_get_pc(vm), frame - 1);
+    }
+
+    const RenderEngine* re = cvm8_framebuffer(vm);
+
+    if (dump) {
+        for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+            for (uint8_t x = 0; x < CHIP8_SCREEN_WIDTH; x++) {
+                fputc(cvm8_is_pixel_on(vm, x, y) ? '#' : '.', stdout);
+            }
+            fputc('\n', stdout);
+        }
+    }
+
+    // FNV-1a over the rows, cheap way to compare runs.
+    uint64_t screen_hash = 0xCBF29CE484222325ULL;
+    for (uint8_t y = 0; y < CHIP8_SCREEN_HEIGHT; y++) {
+        screen_hash = (screen_hash ^ re->rows[y]) * 0x100000001B3ULL;
+    }
+
+    fprintf(stdout, "[INFO] %s : %lu frames, %lu instructions per frame, %llu beeps, screen generation %llu, screen hash %016llx\n",
+        rom_path, frames, ipf, (unsigned long long)beeps, (unsigned long long)re->generation, (unsigned long long)screen_hash);
+    if (audio != NULL) fprintf(stdout, "[INFO] %s : %llu sounding frames, audio hash %016llx\n", rom_path, (unsigned long long)sounding_frames, (unsigned long long)audio_hash);
+    if (cvm8_is_halted(vm)) fprintf(stdout, "[INFO] %s : halted in Fx0A at 0x%03x, no keys left to resume it\n", rom_path, cvm8_get_pc(vm));
+    cvm8_print_fusion_report(vm, rom_path);
+    sched_print_stats(&sched, "Scheduler");
+
+    bool saved = save_state_path == NULL || cvm8_save_state(vm, save_state_path);
+    if (save_state_path != NULL && saved) fprintf(stdout, "[INFO] %s : state saved to %s at cycle %llu, state hash %016llx\n",
+        rom_path, save_state_path, (unsigned long long)cvm8_get_cycle(vm), (unsigned long long)cvm8_hash_state(vm));
+
+    if (input != NULL) fclose(input);
+    if (audio != NULL) fclose(audio);
+    cvm8_destroy(vm);
+    return trap == CPU_TRAP_NONE && saved ? EXIT_SUCCESS : EXIT_FAILURE;
+}